@@ -1,5 +1,6 @@
 [org 0x7c00]
-KERNEL_OFFSET equ 0x1000 
+STAGE2_OFFSET equ 0x7e00
+STAGE2_SECTORS equ 4     ; Must match boot/stage2.asm
 
     xor ax, ax      
     mov ds, ax      
@@ -10,35 +11,27 @@ KERNEL_OFFSET equ 0x1000
 
     mov [BOOT_DRIVE], dl ; Remember the drive number!
 
-    call load_kernel     ; 1. Load C kernel from disk
-    call switch_to_pm    ; 2. Switch to 32-bit mode
-
-    jmp $                ; Freeze if we fail
+    call load_stage2     ; 1. Load the stage-2 loader from disk
+    mov dl, [BOOT_DRIVE]
+    jmp 0:STAGE2_OFFSET  ; 2. Stage 2 loads the kernel and enters 32-bit mode
 
 ; Include the helpers
 %include "boot/print_string.asm"
 %include "boot/disk_load.asm"
-%include "boot/gdt.asm"
-%include "boot/switch_pm.asm"
 
 [bits 16]
-load_kernel:
+load_stage2:
     mov bx, MSG_LOAD
     call print_string
     
-    mov bx, KERNEL_OFFSET ; Load to 0x1000
-    mov dh, 50            ; Read 15 sectors
+    mov bx, STAGE2_OFFSET ; Load to 0x7e00 (right after us)
+    mov dh, STAGE2_SECTORS
     mov dl, [BOOT_DRIVE]
     call disk_load
     ret
 
-[bits 32]
-BEGIN_PM:
-    call KERNEL_OFFSET    ; 3. Jump to C Code
-    jmp $
-
 BOOT_DRIVE db 0
-MSG_LOAD db "Loading EduOS Kernel...", 0
+MSG_LOAD db "Loading EduOS...", 0
 
 times 510-($-$$) db 0
-dw 0xaa55
\ No newline at end of file
+dw 0xaa55
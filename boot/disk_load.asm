@@ -1,4 +1,9 @@
+; Read dh sectors from drive dl, starting at CHS 0/0/2, into es:bx.
+; Resets the drive and retries a few times before giving up.
 disk_load:
+    pusha
+    mov di, 3            ; Attempts left
+.retry:
     push dx
     mov ah, 0x02
     mov al, dh
@@ -6,10 +11,21 @@ disk_load:
     mov dh, 0x00
     mov cl, 0x02
     int 0x13
-    jc disk_error
     pop dx
+    jc .failed
     cmp dh, al
-    jne disk_error
+    jne .failed
+    popa
     ret
+.failed:
+    dec di
+    jz disk_error
+    xor ah, ah           ; Reset the drive
+    int 0x13
+    jmp .retry
 disk_error:
-    jmp $
\ No newline at end of file
+    mov bx, MSG_DISK_ERROR
+    call print_string
+    jmp $
+
+MSG_DISK_ERROR db " Disk error!", 0
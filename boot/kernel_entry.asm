@@ -1,4 +1,24 @@
 [bits 32]
 [extern kernel_main] ; Make sure this matches 'void kernel_main()' in C
-call kernel_main
-jmp $
\ No newline at end of file
+[extern _edata]      ; End of the loaded image (provided by ld)
+[extern _end]        ; End of .bss
+
+    jmp short entry
+
+; Kernel header, read by boot/stage2.asm to know how much to load
+align 4
+    dd 0x4b554445    ; Magic "EDUK"
+    dd _edata
+    dd _end
+
+entry:
+    ; .bss is not part of the image, so clear it ourselves
+    mov edi, _edata
+    mov ecx, _end
+    sub ecx, edi
+    xor eax, eax
+    cld
+    rep stosb
+
+    call kernel_main
+    jmp $
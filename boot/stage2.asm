@@ -0,0 +1,305 @@
+; Stage-2 loader. boot.asm loads us to 0x7e00 and jumps here in real
+; mode with dl = boot drive. We collect the E820 memory map, read the
+; kernel with INT 13h extensions (CHS fallback) in large chunks into a
+; bounce buffer, copy each chunk above 1 MiB through unreal mode and
+; finally switch to protected mode and call the kernel.
+[org 0x7e00]
+[bits 16]
+
+STAGE2_SECTORS equ 4          ; Must match boot/boot.asm
+KERNEL_LBA     equ 1 + STAGE2_SECTORS
+KERNEL_ADDR    equ 0x100000   ; Must match KERNEL_ADDR in the makefile
+KERNEL_MAGIC   equ 0x4b554445 ; "EDUK", see boot/kernel_entry.asm
+
+BOUNCE_SEG     equ 0x1000     ; 64 KiB bounce buffer at 0x10000
+BOUNCE_ADDR    equ 0x10000
+CHUNK_SECTORS  equ 64         ; 32 KiB per BIOS call
+
+; Boot info block handed to the kernel (see kernel/bootinfo.h)
+BOOT_INFO       equ 0x0500
+BI_DRIVE        equ 0
+BI_KERNEL_BYTES equ 4
+BI_MMAP_COUNT   equ 8
+BI_TSC_STAGE2   equ 16
+BI_TSC_LOADED   equ 24
+BI_MMAP         equ 64
+MMAP_MAX        equ 32
+BI_SIZE         equ BI_MMAP + MMAP_MAX * 24
+
+stage2_start:
+    mov [BOOT_DRIVE], dl
+
+    ; Clear the boot info block
+    xor ax, ax
+    mov di, BOOT_INFO
+    mov cx, BI_SIZE / 2
+    cld
+    rep stosw
+    movzx eax, dl
+    mov [BOOT_INFO + BI_DRIVE], eax
+
+    rdtsc
+    mov [BOOT_INFO + BI_TSC_STAGE2], eax
+    mov [BOOT_INFO + BI_TSC_STAGE2 + 4], edx
+
+    call enable_a20
+    call detect_memory
+    call enter_unreal
+    call load_kernel
+
+    rdtsc
+    mov [BOOT_INFO + BI_TSC_LOADED], eax
+    mov [BOOT_INFO + BI_TSC_LOADED + 4], edx
+
+    call switch_to_pm    ; Never returns
+    jmp $
+
+%include "boot/print_string.asm"
+%include "boot/gdt.asm"
+%include "boot/switch_pm.asm"
+
+[bits 16]
+enable_a20:
+    mov ax, 0x2401       ; Ask the BIOS first
+    int 0x15
+    in al, 0x92          ; Then "fast A20" through the system control port
+    test al, 2
+    jnz .done
+    or al, 2
+    and al, 0xfe         ; Bit 0 would reset the machine
+    out 0x92, al
+.done:
+    ret
+
+; Store the BIOS E820 memory map in the boot info block
+detect_memory:
+    mov di, BOOT_INFO + BI_MMAP
+    xor ebx, ebx
+    xor si, si           ; Entries stored
+.next:
+    mov eax, 0xe820
+    mov edx, 0x534d4150  ; "SMAP"
+    mov ecx, 24
+    mov dword [di + 20], 1
+    int 0x15
+    jc .done             ; Unsupported, or past the last entry
+    cmp eax, 0x534d4150
+    jne .done
+    jcxz .skip           ; Ignore empty entries
+    inc si
+    add di, 24
+.skip:
+    test ebx, ebx        ; ebx = 0 after the last entry
+    jz .done
+    cmp si, MMAP_MAX
+    jb .next
+.done:
+    mov [BOOT_INFO + BI_MMAP_COUNT], si
+    ret
+
+; Give ds and es a 4 GiB limit and return to real mode ("unreal mode"),
+; so 32-bit addresses can reach memory above 1 MiB. BIOS calls may reload
+; the segment caches, so this is redone after every disk read.
+enter_unreal:
+    cli
+    push ds
+    push es
+    lgdt [gdt_descriptor]
+    mov eax, cr0
+    or al, 1
+    mov cr0, eax
+    jmp $+2
+    mov bx, DATA_SEG
+    mov ds, bx
+    mov es, bx
+    and al, 0xfe
+    mov cr0, eax
+    pop es
+    pop ds
+    sti
+    ret
+
+load_kernel:
+    mov bx, MSG_STAGE2
+    call print_string
+    call check_disk
+
+    ; Read the first sector to get the image size from the header
+    mov dword [lba], KERNEL_LBA
+    mov cx, 1
+    call read_chunk
+    mov eax, [dword BOUNCE_ADDR + 4]
+    cmp eax, KERNEL_MAGIC
+    jne .bad_kernel
+    mov eax, [dword BOUNCE_ADDR + 8]
+    sub eax, KERNEL_ADDR
+    mov [BOOT_INFO + BI_KERNEL_BYTES], eax
+    add eax, 511
+    shr eax, 9
+    mov [sectors_left], eax
+    mov dword [load_dest], KERNEL_ADDR
+
+.next:
+    mov eax, [sectors_left]
+    test eax, eax
+    jz .done
+    cmp eax, CHUNK_SECTORS
+    jbe .count_ok
+    mov eax, CHUNK_SECTORS
+.count_ok:
+    mov [chunk], ax
+    mov cx, ax
+    call read_chunk
+
+    ; Copy the chunk from the bounce buffer to its final place
+    movzx ecx, word [chunk]
+    shl ecx, 7           ; Sectors -> dwords
+    mov esi, BOUNCE_ADDR
+    mov edi, [load_dest]
+    cld
+    a32 rep movsd
+    mov [load_dest], edi
+
+    movzx eax, word [chunk]
+    add [lba], eax
+    sub [sectors_left], eax
+    jmp .next
+.done:
+    ret
+.bad_kernel:
+    mov bx, MSG_BAD_KERNEL
+    call print_string
+    jmp $
+
+; Use INT 13h extensions if the BIOS has them, else fetch the CHS geometry
+check_disk:
+    mov ah, 0x41
+    mov bx, 0x55aa
+    mov dl, [BOOT_DRIVE]
+    int 0x13
+    jc .chs
+    cmp bx, 0xaa55
+    jne .chs
+    test cx, 1           ; Bit 0: packet (AH=42h) access supported
+    jz .chs
+    mov byte [use_lba], 1
+    ret
+.chs:
+    mov ah, 0x08
+    mov dl, [BOOT_DRIVE]
+    push es
+    xor di, di
+    int 0x13
+    pop es
+    jc .done             ; Keep the 1.44M floppy defaults
+    and cl, 0x3f
+    mov [chs_spt], cl
+    inc dh
+    mov [chs_heads], dh
+.done:
+    ret
+
+; Read cx sectors starting at [lba] into the bounce buffer, with retries
+read_chunk:
+    mov di, 3            ; Attempts left
+.retry:
+    push cx
+    push di
+    cmp byte [use_lba], 0
+    je .chs
+    mov [dap_count], cx
+    mov eax, [lba]
+    mov [dap_lba], eax
+    mov si, dap
+    mov ah, 0x42
+    mov dl, [BOOT_DRIVE]
+    int 0x13
+    jmp .check
+.chs:
+    call read_chs
+.check:
+    pop di
+    pop cx
+    jc .failed
+    call enter_unreal
+    ret
+.failed:
+    dec di
+    jz disk_error
+    xor ah, ah           ; Reset the drive
+    mov dl, [BOOT_DRIVE]
+    int 0x13
+    jmp .retry
+
+; CHS fallback: one sector per call. Sets CF on error.
+read_chs:
+    push es
+    mov ax, BOUNCE_SEG
+    mov es, ax
+    xor bx, bx
+    mov eax, [lba]
+.sector:
+    push eax
+    push cx
+    xor edx, edx
+    movzx esi, byte [chs_spt]
+    div esi              ; eax = track, edx = sector - 1
+    mov cl, dl
+    inc cl
+    xor edx, edx
+    movzx esi, byte [chs_heads]
+    div esi              ; eax = cylinder, edx = head
+    mov dh, dl
+    mov ch, al
+    shl ah, 6            ; Cylinder bits 8-9 go in cl[7:6]
+    or cl, ah
+    mov dl, [BOOT_DRIVE]
+    mov ax, 0x0201
+    int 0x13
+    pop cx
+    pop eax
+    jc .error
+    inc eax
+    add bx, 512
+    loop .sector
+    pop es
+    clc
+    ret
+.error:
+    pop es
+    stc
+    ret
+
+disk_error:
+    mov bx, MSG_DISK_ERROR
+    call print_string
+    jmp $
+
+[bits 32]
+BEGIN_PM:
+    call KERNEL_ADDR     ; 3. Jump to C Code
+    jmp $
+
+BOOT_DRIVE   db 0
+use_lba      db 0
+chs_spt      db 18
+chs_heads    db 2
+chunk        dw 0
+lba          dd 0
+sectors_left dd 0
+load_dest    dd 0
+
+align 4
+dap:                     ; INT 13h extensions disk address packet
+    db 0x10, 0
+dap_count:
+    dw 0
+    dw 0, BOUNCE_SEG     ; Buffer offset:segment
+dap_lba:
+    dd 0, 0
+
+MSG_STAGE2     db 13, 10, "Stage 2: loading kernel...", 0
+MSG_BAD_KERNEL db " Bad kernel header!", 0
+MSG_DISK_ERROR db " Disk error!", 0
+
+times STAGE2_SECTORS*512-($-$$) db 0
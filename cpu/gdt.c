@@ -0,0 +1,43 @@
+#include "gdt.h"
+
+// Replaces the boot GDT (boot/gdt.asm) with one that also has ring-3
+// segments and a TSS. All segments are flat: there is no paging yet, so
+// ring 3 is about privilege (no cli, in/out, lgdt...), not memory isolation.
+
+gdt_entry_t gdt[GDT_ENTRIES];
+gdt_register_t gdt_reg;
+tss_t tss;
+
+void gdt_flush(u32 gdt_reg_addr); // cpu/syscall.asm
+
+void set_gdt_entry(int n, u32 base, u32 limit, u8 access, u8 granularity) {
+    gdt[n].limit_low = (u16)(limit & 0xFFFF);
+    gdt[n].base_low = (u16)(base & 0xFFFF);
+    gdt[n].base_mid = (u8)((base >> 16) & 0xFF);
+    gdt[n].access = access;
+    gdt[n].granularity = (u8)((granularity & 0xF0) | ((limit >> 16) & 0x0F));
+    gdt[n].base_high = (u8)((base >> 24) & 0xFF);
+}
+
+void init_gdt() {
+    set_gdt_entry(0, 0, 0, 0, 0);
+    set_gdt_entry(1, 0, 0xFFFFF, 0x9A, 0xCF); // Kernel code
+    set_gdt_entry(2, 0, 0xFFFFF, 0x92, 0xCF); // Kernel data
+    set_gdt_entry(3, 0, 0xFFFFF, 0xFA, 0xCF); // User code (DPL 3)
+    set_gdt_entry(4, 0, 0xFFFFF, 0xF2, 0xCF); // User data (DPL 3)
+
+    tss.ss0 = KERNEL_DS;
+    tss.esp0 = 0x90000; // Boot stack until a user thread runs
+    tss.iomap_base = sizeof(tss_t); // No I/O bitmap: ring 3 gets no ports
+    set_gdt_entry(5, (u32)&tss, sizeof(tss_t) - 1, 0x89, 0x00);
+
+    gdt_reg.base = (u32)&gdt;
+    gdt_reg.limit = GDT_ENTRIES * sizeof(gdt_entry_t) - 1;
+    gdt_flush((u32)&gdt_reg);
+    __asm__ volatile("ltr %0" : : "r"((u16)TSS_SEL));
+}
+
+// Stack used when ring 3 enters the kernel (interrupt, int 0x80, sysenter)
+void tss_set_kernel_stack(u32 esp0) {
+    tss.esp0 = esp0;
+}
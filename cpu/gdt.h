@@ -0,0 +1,47 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include "../kernel/types.h"
+
+// Segment selectors. The order (kernel code, kernel data, user code, user
+// data) is the one sysenter/sysexit expect, see kernel/syscall.c.
+#define KERNEL_DS 0x10
+#define USER_CS   0x1B     // 0x18 | RPL 3
+#define USER_DS   0x23     // 0x20 | RPL 3
+#define TSS_SEL   0x28
+
+#define GDT_ENTRIES 6
+
+typedef struct {
+    u16 limit_low;
+    u16 base_low;
+    u8 base_mid;
+    u8 access;
+    u8 granularity;
+    u8 base_high;
+} __attribute__((packed)) gdt_entry_t;
+
+typedef struct {
+    u16 limit;
+    u32 base;
+} __attribute__((packed)) gdt_register_t;
+
+// Only ss0/esp0 are used: the stack the CPU switches to on entry from ring 3
+typedef struct {
+    u32 prev_tss;
+    u32 esp0;
+    u32 ss0;
+    u32 esp1, ss1, esp2, ss2;
+    u32 cr3, eip, eflags;
+    u32 eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    u32 es, cs, ss, ds, fs, gs, ldt;
+    u16 trap;
+    u16 iomap_base;
+} __attribute__((packed)) tss_t;
+
+extern tss_t tss;
+
+void init_gdt();
+void tss_set_kernel_stack(u32 esp0);
+
+#endif
@@ -5,6 +5,10 @@
 
 #define KERNEL_CS 0x08
 
+// 32-bit interrupt gates; the user one may be raised with int from ring 3
+#define IDT_KERNEL_GATE 0x8E
+#define IDT_USER_GATE   0xEE
+
 typedef struct {
     u16 low_offset; 
     u16 sel; 
@@ -20,6 +24,7 @@ typedef struct {
 
 #define IDT_ENTRIES 256
 void set_idt_gate(int n, u32 handler);
+void set_idt_gate_flags(int n, u32 handler, u8 flags);
 void set_idt();
 
 #endif
\ No newline at end of file
@@ -5,4 +5,30 @@ isr_keyboard:
     pusha           ; Save registers
     call isr_keyboard_handler
     popa            ; Restore registers
-    iret            ; Return from interrupt
\ No newline at end of file
+    iret            ; Return from interrupt
+
+[global isr_page_fault]
+[extern page_fault_handler]
+
+; The CPU pushes an error code for page faults; cr2 holds the address
+isr_page_fault:
+    pusha
+    mov eax, [esp+32]   ; Error code, below the pusha frame
+    push eax
+    mov eax, cr2
+    push eax
+    call page_fault_handler
+    add esp, 8
+    popa
+    add esp, 4          ; Drop the error code
+    iret
+
+
+[global isr_timer]
+[extern isr_timer_handler]
+
+isr_timer:
+    pusha
+    call isr_timer_handler
+    popa
+    iret
@@ -0,0 +1,44 @@
+#include "simd.h"
+#include "../kernel/types.h"
+#include "../libc/string.h"
+
+// Turn on SSE so libc can use SSE2 (mem_find). Only kernel code uses the
+// XMM registers, and never across a context switch, so they are not saved.
+// CR0.TS stays set outside simd_begin()/simd_end(), so any other SSE
+// instruction, ring 3 included, faults instead of seeing or clobbering
+// XMM state that nobody saves.
+
+#define CPUID_SSE2 (1 << 26)
+#define CR0_MP 0x002
+#define CR0_EM 0x004
+#define CR0_TS 0x008
+#define CR4_OSFXSR 0x200
+#define CR4_OSXMMEXCPT 0x400
+
+void init_simd() {
+    u32 eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_SSE2)) return;
+
+    u32 reg;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(reg));
+    __asm__ volatile("mov %0, %%cr0" : : "r"((reg & ~CR0_EM) | CR0_MP | CR0_TS));
+    __asm__ volatile("mov %%cr4, %0" : "=r"(reg));
+    __asm__ volatile("mov %0, %%cr4" : : "r"(reg | CR4_OSFXSR | CR4_OSXMMEXCPT));
+    sse2_enabled = 1;
+}
+
+int simd_depth = 0;
+
+// Allow SSE until the matching simd_end(). Calls nest, so a caller can
+// pay for the CR0 write once around many mem_find()s.
+void simd_begin() {
+    if (simd_depth++ == 0) __asm__ volatile("clts");
+}
+
+void simd_end() {
+    if (--simd_depth > 0) return;
+    u32 reg;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(reg));
+    __asm__ volatile("mov %0, %%cr0" : : "r"(reg | CR0_TS));
+}
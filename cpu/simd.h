@@ -0,0 +1,8 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+void init_simd();
+void simd_begin();
+void simd_end();
+
+#endif
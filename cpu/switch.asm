@@ -0,0 +1,21 @@
+[global switch_context]
+
+; void switch_context(u32* old_esp, u32 new_esp)
+; Save the callee-saved registers and flags on the current stack, store
+; esp in *old_esp, then resume the context saved on new_esp.
+switch_context:
+    mov eax, [esp+4]
+    mov edx, [esp+8]
+    push ebp
+    push ebx
+    push esi
+    push edi
+    pushfd
+    mov [eax], esp
+    mov esp, edx
+    popfd
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
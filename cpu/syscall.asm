@@ -0,0 +1,90 @@
+; Privilege switching: GDT reload, entering ring 3, and both system call
+; entry paths (sysenter and int 0x80). See kernel/syscall.c; the user
+; side is libc/syscall_stubs.asm.
+[global gdt_flush]
+[global enter_user_mode]
+[global sysenter_entry]
+[global isr_syscall]
+[extern syscall_dispatch]
+[extern tss]
+
+KERNEL_CS equ 0x08
+KERNEL_DS equ 0x10
+USER_CS   equ 0x1b
+USER_DS   equ 0x23
+USER_EFLAGS equ 0x002 ; Interrupts stay off in ring 3 too: scheduling is cooperative
+
+; void gdt_flush(u32 gdt_reg_addr)
+gdt_flush:
+    mov eax, [esp+4]
+    lgdt [eax]
+    mov ax, KERNEL_DS
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+    jmp KERNEL_CS:.flush ; Reload cs
+.flush:
+    ret
+
+; void enter_user_mode(u32 eip, u32 esp)
+; iret into ring 3. Never returns: the program leaves through SYS_EXIT.
+enter_user_mode:
+    mov eax, [esp+4]
+    mov ecx, [esp+8]
+    mov dx, USER_DS
+    mov ds, dx
+    mov es, dx
+    mov fs, dx
+    mov gs, dx
+    push USER_DS       ; ss
+    push ecx           ; esp
+    push USER_EFLAGS
+    push USER_CS
+    push eax           ; eip
+    iret
+
+; --- Kernel side ---
+; Calls arrive with eax = number and ebx, esi, edi = arguments; the result
+; goes back in eax. The user stubs save every other register.
+
+; sysenter lands here with interrupts off, cs/ss from the MSRs and a
+; throwaway esp. The real kernel stack is the current thread's, in tss.esp0.
+; The user stub passes its esp in ecx and return address in edx.
+sysenter_entry:
+    mov esp, [tss + 4]
+    push ecx           ; User esp
+    push edx           ; User eip
+    mov bp, KERNEL_DS
+    mov ds, bp
+    mov es, bp
+    push edi
+    push esi
+    push ebx
+    push eax
+    call syscall_dispatch
+    add esp, 16
+    mov bp, USER_DS
+    mov ds, bp
+    mov es, bp
+    pop edx            ; sysexit: eip = edx, esp = ecx
+    pop ecx
+    sysexit
+
+; int 0x80 (DPL 3 interrupt gate): the CPU has already switched to tss.esp0
+isr_syscall:
+    push ds
+    push es
+    mov bp, KERNEL_DS
+    mov ds, bp
+    mov es, bp
+    push edi
+    push esi
+    push ebx
+    push eax
+    call syscall_dispatch
+    add esp, 16
+    pop es
+    pop ds
+    iret
@@ -0,0 +1,8 @@
+#include "tsc.h"
+
+// Read the CPU time stamp counter (cycles since reset)
+u64 rdtsc() {
+    u32 low, high;
+    __asm__ volatile("rdtsc" : "=a" (low), "=d" (high));
+    return ((u64)high << 32) | low;
+}
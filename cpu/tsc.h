@@ -0,0 +1,7 @@
+#ifndef TSC_H
+#define TSC_H
+
+#include "../kernel/types.h"
+
+u64 rdtsc();
+#endif
@@ -0,0 +1,122 @@
+#include "ata.h"
+#include "ports.h"
+
+// PIO driver for one ATA disk, polled (the device's interrupt is off).
+// 28-bit LBA, so up to 128 GiB.
+
+#define ATA_SLAVE_LBA 0xF0 // LBA mode, drive 1
+
+#define ATA_SR_BSY  0x80
+#define ATA_SR_DF   0x20
+#define ATA_SR_DRQ  0x08
+#define ATA_SR_ERR  0x01
+
+#define ATA_CMD_READ     0x20
+#define ATA_CMD_WRITE    0x30
+#define ATA_CMD_FLUSH    0xE7
+#define ATA_CMD_IDENTIFY 0xEC
+
+#define ATA_NIEN 0x02       // Control register: no interrupts
+#define ATA_TIMEOUT 1000000 // Status polls before giving up
+#define ATA_MAX_COUNT 128   // Sectors per command
+
+u32 ata_sectors = 0; // 0 if there is no disk
+
+// Reading the status register takes about 100 ns: four reads give the
+// drive the 400 ns it needs after a drive select or command
+void ata_delay() {
+    for (int i = 0; i < 4; i++) port_byte_in(ATA_STATUS);
+}
+
+// Wait until the drive is not busy (and, if drq, has data ready).
+// Returns 0 on error or timeout.
+int ata_wait(int drq) {
+    for (int i = 0; i < ATA_TIMEOUT; i++) {
+        u8 status = port_byte_in(ATA_STATUS);
+        if (status & ATA_SR_BSY) continue;
+        if (status & (ATA_SR_ERR | ATA_SR_DF)) return 0;
+        if (!drq || (status & ATA_SR_DRQ)) return 1;
+    }
+    return 0;
+}
+
+// Returns the disk's size in sectors, or 0 if there is no ATA disk
+u32 init_ata() {
+    port_byte_out(ATA_CONTROL, ATA_NIEN);
+    port_byte_out(ATA_DRIVE, ATA_SLAVE_LBA);
+    ata_delay();
+    port_byte_out(ATA_COUNT, 0);
+    port_byte_out(ATA_LBA0, 0);
+    port_byte_out(ATA_LBA1, 0);
+    port_byte_out(ATA_LBA2, 0);
+    port_byte_out(ATA_COMMAND, ATA_CMD_IDENTIFY);
+
+    u8 status = port_byte_in(ATA_STATUS);
+    if (status == 0 || status == 0xFF) return 0; // No drive, or no bus
+    for (int i = 0; i < ATA_TIMEOUT && (port_byte_in(ATA_STATUS) & ATA_SR_BSY); i++);
+    // ATAPI and SATA devices abort IDENTIFY and leave a signature here
+    if (port_byte_in(ATA_LBA1) || port_byte_in(ATA_LBA2)) return 0;
+    if (!ata_wait(1)) return 0;
+
+    u16 id[256];
+    for (int i = 0; i < 256; i++) id[i] = port_word_in(ATA_DATA);
+    ata_sectors = id[60] | ((u32)id[61] << 16); // LBA28 sector count
+    return ata_sectors;
+}
+
+void ata_command(u32 lba, u32 count, u8 command) {
+    port_byte_out(ATA_DRIVE, ATA_SLAVE_LBA | ((lba >> 24) & 0x0F));
+    port_byte_out(ATA_COUNT, count);
+    port_byte_out(ATA_LBA0, lba);
+    port_byte_out(ATA_LBA1, lba >> 8);
+    port_byte_out(ATA_LBA2, lba >> 16);
+    port_byte_out(ATA_COMMAND, command);
+    ata_delay();
+}
+
+int ata_range_ok(u32 lba, u32 count) {
+    return ata_sectors && lba < ata_sectors && count <= ata_sectors - lba;
+}
+
+// Both return 1 on success
+int ata_read(u32 lba, u32 count, void* buf) {
+    if (!ata_range_ok(lba, count)) return 0;
+    u16* words = (u16*)buf;
+    while (count > 0) {
+        u32 n = count < ATA_MAX_COUNT ? count : ATA_MAX_COUNT;
+        ata_command(lba, n, ATA_CMD_READ);
+        for (u32 s = 0; s < n; s++) {
+            if (!ata_wait(1)) return 0;
+            for (int i = 0; i < ATA_SECTOR_SIZE / 2; i++) *words++ = port_word_in(ATA_DATA);
+        }
+        lba += n;
+        count -= n;
+    }
+    return 1;
+}
+
+// The data may still sit in the drive's write cache: see ata_flush()
+int ata_write(u32 lba, u32 count, void* buf) {
+    if (!ata_range_ok(lba, count)) return 0;
+    u16* words = (u16*)buf;
+    while (count > 0) {
+        u32 n = count < ATA_MAX_COUNT ? count : ATA_MAX_COUNT;
+        ata_command(lba, n, ATA_CMD_WRITE);
+        for (u32 s = 0; s < n; s++) {
+            if (!ata_wait(1)) return 0;
+            for (int i = 0; i < ATA_SECTOR_SIZE / 2; i++) port_word_out(ATA_DATA, *words++);
+        }
+        lba += n;
+        count -= n;
+    }
+    return ata_wait(0);
+}
+
+// Returns once everything written so far is on the medium
+int ata_flush() {
+    if (!ata_sectors) return 0;
+    port_byte_out(ATA_DRIVE, ATA_SLAVE_LBA);
+    port_byte_out(ATA_COMMAND, ATA_CMD_FLUSH);
+    ata_delay();
+    return ata_wait(0);
+}
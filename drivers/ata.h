@@ -0,0 +1,25 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include "../kernel/types.h"
+
+// Primary ATA bus. The boot image is the master; the file system disk is
+// the slave (QEMU: -drive format=raw,file=fs.img,index=1).
+#define ATA_DATA    0x1F0
+#define ATA_COUNT   0x1F2
+#define ATA_LBA0    0x1F3
+#define ATA_LBA1    0x1F4
+#define ATA_LBA2    0x1F5
+#define ATA_DRIVE   0x1F6
+#define ATA_STATUS  0x1F7
+#define ATA_COMMAND 0x1F7
+#define ATA_CONTROL 0x3F6
+
+#define ATA_SECTOR_SIZE 512
+
+u32 init_ata();
+int ata_read(u32 lba, u32 count, void* buf);
+int ata_write(u32 lba, u32 count, void* buf);
+int ata_flush();
+
+#endif
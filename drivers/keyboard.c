@@ -4,152 +4,269 @@
 #include "../cpu/idt.h"
 #include "../libc/string.h"
 
-#define SC_MAX 57
-#define BACKSPACE 0x0E
-#define ENTER 0x1C
+#define KBD_DATA 0x60
+#define KBD_STATUS 0x64
+#define KBD_OUTPUT_FULL 0x01
+#define KBD_AUX_DATA 0x20 // The byte is from the mouse port
+
+#define RELEASED 0x80
 
 // Control Keys
 #define L_SHIFT 0x2A
 #define R_SHIFT 0x36
 #define CAPS_LOCK 0x3A
-#define L_SHIFT_REL 0xAA
-#define R_SHIFT_REL 0xB6
+#define ALT 0x38          // Right Alt (AltGr) after 0xE0
 
 // Extended Keys
 #define ARROW_UP    0x48
 #define ARROW_DOWN  0x50
 #define ARROW_LEFT  0x4B
 #define ARROW_RIGHT 0x4D
+#define HOME_KEY    0x47
+#define END_KEY     0x4F
 #define DELETE_KEY  0x53
+#define KP_ENTER    0x1C
+#define KP_SLASH    0x35
+
+// --- Keymap (US layout, scancode set 1) ---
+//
+// One row per key: scancode, plain, shift, AltGr. The layer tables below
+// are generated from it at compile time, so decoding a key is a single
+// lookup. AltGr gives the US-International letters that code page 437
+// (the VGA font) has. 0 means the key types nothing.
+#define KEYMAP(K) \
+    K(0x02, '1', '!', 0xAD) K(0x03, '2', '@', 0xFD) K(0x04, '3', '#', 0) \
+    K(0x05, '4', '$', 0) K(0x06, '5', '%', 0) K(0x07, '6', '^', 0xAC) \
+    K(0x08, '7', '&', 0xAB) K(0x09, '8', '*', 0) K(0x0A, '9', '(', 0) \
+    K(0x0B, '0', ')', 0) K(0x0C, '-', '_', 0x9D) K(0x0D, '=', '+', 0) \
+    K(0x0E, '\b', '\b', '\b') \
+    K(0x10, 'q', 'Q', 0x84) K(0x11, 'w', 'W', 0x86) K(0x12, 'e', 'E', 0x82) \
+    K(0x13, 'r', 'R', 0) K(0x14, 't', 'T', 0) K(0x15, 'y', 'Y', 0x81) \
+    K(0x16, 'u', 'U', 0xA3) K(0x17, 'i', 'I', 0xA1) K(0x18, 'o', 'O', 0xA2) \
+    K(0x19, 'p', 'P', 0x94) K(0x1A, '[', '{', 0) K(0x1B, ']', '}', 0) \
+    K(0x1C, '\n', '\n', '\n') \
+    K(0x1E, 'a', 'A', 0xA0) K(0x1F, 's', 'S', 0xE1) K(0x20, 'd', 'D', 0) \
+    K(0x21, 'f', 'F', 0) K(0x22, 'g', 'G', 0) K(0x23, 'h', 'H', 0) \
+    K(0x24, 'j', 'J', 0) K(0x25, 'k', 'K', 0) K(0x26, 'l', 'L', 0) \
+    K(0x27, ';', ':', 0) K(0x28, '\'', '"', 0) K(0x29, '`', '~', 0) \
+    K(0x2B, '\\', '|', 0) \
+    K(0x2C, 'z', 'Z', 0x91) K(0x2D, 'x', 'X', 0) K(0x2E, 'c', 'C', 0) \
+    K(0x2F, 'v', 'V', 0) K(0x30, 'b', 'B', 0) K(0x31, 'n', 'N', 0xA4) \
+    K(0x32, 'm', 'M', 0xE6) K(0x33, ',', '<', 0x87) K(0x34, '.', '>', 0) \
+    K(0x35, '/', '?', 0xA8) \
+    K(0x37, '*', '*', 0) K(0x39, ' ', ' ', ' ') \
+    K(0x47, '7', '7', 0) K(0x48, '8', '8', 0) K(0x49, '9', '9', 0) \
+    K(0x4A, '-', '-', 0) K(0x4B, '4', '4', 0) K(0x4C, '5', '5', 0) \
+    K(0x4D, '6', '6', 0) K(0x4E, '+', '+', 0) K(0x4F, '1', '1', 0) \
+    K(0x50, '2', '2', 0) K(0x51, '3', '3', 0) K(0x52, '0', '0', 0) \
+    K(0x53, '.', '.', 0) K(0x56, '\\', '|', 0)
+
+#define IS_LOWER(c) ((c) >= 'a' && (c) <= 'z')
+#define LAYER_PLAIN(sc, plain, shift, altgr) [sc] = plain,
+#define LAYER_SHIFT(sc, plain, shift, altgr) [sc] = shift,
+// Caps Lock only affects letters, and Shift undoes it
+#define LAYER_CAPS(sc, plain, shift, altgr) [sc] = IS_LOWER(plain) ? shift : plain,
+#define LAYER_CAPS_SHIFT(sc, plain, shift, altgr) [sc] = IS_LOWER(plain) ? plain : shift,
+#define LAYER_ALTGR(sc, plain, shift, altgr) [sc] = altgr,
 
-static char key_buffer[256]; 
-static int extended_mode = 0; 
-static int cursor_pos = 0; 
+#define KEYMAP_SIZE 0x80
+#define LAYER_ALTGR_INDEX 4
+
+// Indexed by shift | caps << 1, or LAYER_ALTGR_INDEX
+static const u8 keymap[5][KEYMAP_SIZE] = {
+    { KEYMAP(LAYER_PLAIN) },
+    { KEYMAP(LAYER_SHIFT) },
+    { KEYMAP(LAYER_CAPS) },
+    { KEYMAP(LAYER_CAPS_SHIFT) },
+    { KEYMAP(LAYER_ALTGR) },
+};
+
+static char key_buffer[256];
+static int line_len = 0;
+static int extended_mode = 0;
+static int cursor_pos = 0;
 
 // State tracking
-static int shift_pressed = 0; 
-static int caps_lock_active = 0; // <--- NEW: Track Caps Lock
+static int shift_keys = 0; // One bit per shift key held
+static int caps_lock_active = 0;
+static int altgr_pressed = 0;
 
-// Lowercase by default
-const char sc_ascii[] = { '?', '?', '1', '2', '3', '4', '5', '6',     
-    '7', '8', '9', '0', '-', '=', '?', '?', 'q', 'w', 'e', 'r', 't', 'y', 
-        'u', 'i', 'o', 'p', '[', ']', '?', '?', 'a', 's', 'd', 'f', 'g', 
-        'h', 'j', 'k', 'l', ';', '\'', '`', '?', '\\', 'z', 'x', 'c', 'v', 
-        'b', 'n', 'm', ',', '.', '/', '?', '?', '?', ' '};
+// What the screen shows of the line. Keys only change key_buffer and
+// note the first changed position; keyboard_flush() then redraws the
+// line from there and moves the cursor, once per burst of keys.
+static int line_start = -1; // Screen offset of key_buffer[0], -1 until drawn
+static int shown_len = 0;
+static int shown_cursor = 0;
+static int dirty_from = -1;
 
 void user_input(char *input);
 
-void redraw_line_tail() {
-    int offset_backup = get_cursor_offset();
-    kprint(&key_buffer[cursor_pos]);
-    kprint(" ");
-    set_cursor_offset(offset_backup);
+void mark_dirty(int pos) {
+    if (dirty_from < 0 || pos < dirty_from) dirty_from = pos;
 }
 
-void isr_keyboard_handler() {
-    u8 scancode = port_byte_in(0x60);
-    port_byte_out(0x20, 0x20);
+void keyboard_flush() {
+    if (dirty_from < 0 && cursor_pos == shown_cursor) return;
+    // Taken at the first change, as output may move the cursor until then
+    if (line_start < 0) line_start = get_cursor_offset();
+    if (dirty_from >= 0) {
+        // The changed tail, and blanks over whatever the line lost
+        char tail[sizeof(key_buffer) + 1];
+        int n = 0;
+        for (int i = dirty_from; i < line_len; i++) tail[n++] = key_buffer[i];
+        for (int i = line_len; i < shown_len; i++) tail[n++] = ' ';
+        tail[n] = '\0';
+        int expected = line_start + 2 * (dirty_from + n);
+        int end = kprint_at_offset(tail, line_start + 2 * dirty_from);
+        line_start -= expected - end; // Rows scrolled away
+        shown_len = line_len;
+        dirty_from = -1;
+    }
+    set_cursor_offset(line_start + 2 * cursor_pos);
+    shown_cursor = cursor_pos;
+}
 
-    // 1. Handle Shift Press/Release
-    if (scancode == L_SHIFT || scancode == R_SHIFT) {
-        shift_pressed = 1;
-        return;
+void insert_key(char letter) {
+    // Line is full: drop the key instead of running off the buffer
+    if (line_len >= (int)sizeof(key_buffer) - 1) return;
+    if (cursor_pos == line_len) {
+        key_buffer[line_len] = letter;
+        key_buffer[line_len + 1] = '\0';
+    } else {
+        str_insert_at(key_buffer, letter, cursor_pos);
     }
-    if (scancode == L_SHIFT_REL || scancode == R_SHIFT_REL) {
-        shift_pressed = 0;
-        return;
+    mark_dirty(cursor_pos);
+    line_len++;
+    cursor_pos++;
+}
+
+void delete_key_at(int pos) {
+    str_delete_at(key_buffer, pos);
+    mark_dirty(pos);
+    line_len--;
+}
+
+void reset_line() {
+    key_buffer[0] = '\0';
+    line_len = 0;
+    cursor_pos = 0;
+    line_start = -1;
+    shown_len = 0;
+    shown_cursor = 0;
+    dirty_from = -1;
+}
+
+void enter_key() {
+    char command[sizeof(key_buffer)];
+    // Show the whole line before the command prints anything
+    cursor_pos = line_len;
+    keyboard_flush();
+    kprint("\n");
+    strcpy(command, key_buffer);
+    // Whatever the command prints (or types, like the benchmarks) starts
+    // a new line, and so does the prompt after it
+    reset_line();
+    user_input(command);
+    reset_line();
+}
+
+// Commands run inside this handler, and some (sleep) enable interrupts
+// while they wait. Keys that arrive meanwhile are queued and handled once
+// the command is done, instead of starting a nested command.
+#define PENDING_KEYS 256
+static u8 pending_keys[PENDING_KEYS];
+static u32 pending_head = 0;
+static u32 pending_tail = 0;
+static int handling_key = 0;
+
+void keyboard_enqueue(u8 scancode) {
+    if (pending_tail - pending_head < PENDING_KEYS) pending_keys[pending_tail++ % PENDING_KEYS] = scancode;
+}
+
+// Handle every queued scancode, and whatever else the controller has by
+// then, with one screen update at the end
+void keyboard_drain() {
+    for (;;) {
+        while (pending_head != pending_tail) keyboard_handle_scancode(pending_keys[pending_head++ % PENDING_KEYS]);
+        u8 status = port_byte_in(KBD_STATUS);
+        if ((status & (KBD_OUTPUT_FULL | KBD_AUX_DATA)) != KBD_OUTPUT_FULL) break;
+        keyboard_enqueue(port_byte_in(KBD_DATA));
     }
+    keyboard_flush();
+}
 
-    // 2. Handle Caps Lock (Toggle on press)
-    if (scancode == CAPS_LOCK) {
-        caps_lock_active = !caps_lock_active; // Flip state (0->1 or 1->0)
-        return;
+void isr_keyboard_handler() {
+    // A byte keyboard_drain() already took can still leave its IRQ pending
+    if (port_byte_in(KBD_STATUS) & KBD_OUTPUT_FULL) keyboard_enqueue(port_byte_in(KBD_DATA));
+    port_byte_out(0x20, 0x20);
+    if (handling_key) return;
+    handling_key = 1;
+    keyboard_drain();
+    handling_key = 0;
+}
+
+// Input as if the keys had arrived together (the benchmark suite uses
+// this to drive the whole input path without the PS/2 controller)
+void keyboard_inject(u8* scancodes, int count) {
+    int was_handling = handling_key;
+    for (int i = 0; i < count; i++) keyboard_enqueue(scancodes[i]);
+    handling_key = 1;
+    keyboard_drain();
+    handling_key = was_handling;
+}
+
+void handle_extended(u8 scancode) {
+    switch (scancode) {
+        case ALT: altgr_pressed = 1; break;
+        case ALT | RELEASED: altgr_pressed = 0; break;
+        case KP_ENTER: enter_key(); break;
+        case KP_SLASH: insert_key('/'); break;
+        case ARROW_LEFT:
+            if (cursor_pos > 0) cursor_pos--;
+            break;
+        case ARROW_RIGHT:
+            if (cursor_pos < line_len) cursor_pos++;
+            break;
+        case HOME_KEY: cursor_pos = 0; break;
+        case END_KEY: cursor_pos = line_len; break;
+        case DELETE_KEY:
+            if (cursor_pos < line_len) delete_key_at(cursor_pos);
+            break;
     }
+}
 
+// Decode one scancode into the line buffer. The screen catches up in
+// keyboard_flush().
+void keyboard_handle_scancode(u8 scancode) {
     if (scancode == 0xE0) {
         extended_mode = 1;
         return;
     }
-
     if (extended_mode) {
         extended_mode = 0;
-        int len = strlen(key_buffer);
-        switch (scancode) {
-            case ARROW_LEFT:
-                if (cursor_pos > 0) {
-                    cursor_pos--;
-                    kprint_move_cursor(-1);
-                }
-                break;
-            case ARROW_RIGHT:
-                if (cursor_pos < len) {
-                    cursor_pos++;
-                    kprint_move_cursor(1);
-                }
-                break;
-            case DELETE_KEY:
-                if (cursor_pos < len) {
-                    str_delete_at(key_buffer, cursor_pos);
-                    redraw_line_tail();
-                }
-                break;
-        }
+        handle_extended(scancode);
         return;
     }
 
-    if (scancode > SC_MAX) return;
+    switch (scancode) {
+        case L_SHIFT: shift_keys |= 1; return;
+        case R_SHIFT: shift_keys |= 2; return;
+        case L_SHIFT | RELEASED: shift_keys &= ~1; return;
+        case R_SHIFT | RELEASED: shift_keys &= ~2; return;
+        case CAPS_LOCK: caps_lock_active = !caps_lock_active; return;
+    }
+    if (scancode & RELEASED) return;
 
-    if (scancode == BACKSPACE) {
+    int layer = altgr_pressed ? LAYER_ALTGR_INDEX : (shift_keys != 0) | (caps_lock_active << 1);
+    char letter = keymap[layer][scancode];
+    if (letter == '\n') enter_key();
+    else if (letter == '\b') {
         if (cursor_pos > 0) {
-            str_delete_at(key_buffer, cursor_pos - 1);
             cursor_pos--;
-            kprint_backspace();
-            redraw_line_tail();
-        }
-    } 
-    else if (scancode == ENTER) {
-        kprint("\n");
-        user_input(key_buffer);
-        key_buffer[0] = '\0';
-        cursor_pos = 0;
-    } 
-    else {
-        char letter = sc_ascii[(int)scancode];
-        
-        // 3. Determine if Uppercase is needed
-        // Uppercase if: (Shift IS pressed) XOR (Caps Lock IS active)
-        // This means:
-        // Shift=0, Caps=0 -> Lower
-        // Shift=1, Caps=0 -> Upper
-        // Shift=0, Caps=1 -> Upper
-        // Shift=1, Caps=1 -> Lower (Standard behavior)
-        int uppercase = (shift_pressed ^ caps_lock_active);
-
-        if (uppercase) {
-            if (letter >= 'a' && letter <= 'z') {
-                letter -= 32; // Convert to Uppercase
-            }
-            // Note: Caps Lock usually doesn't affect numbers/symbols,
-            // so we only apply symbol shift if SHIFT is actually held.
-            if (shift_pressed) {
-                if (letter == '1') letter = '!';
-                else if (letter == '9') letter = '(';
-                else if (letter == '0') letter = ')';
-                else if (letter == '-') letter = '_';
-                else if (letter == '=') letter = '+';
-            }
-        }
-
-        str_insert_at(key_buffer, letter, cursor_pos);
-        
-        char str[2] = {letter, '\0'};
-        kprint(str);
-        
-        cursor_pos++;
-        if (cursor_pos < strlen(key_buffer)) {
-             redraw_line_tail();
+            delete_key_at(cursor_pos);
         }
     }
+    else if (letter) insert_key(letter);
 }
 
 void init_keyboard() {
@@ -158,9 +275,9 @@ void init_keyboard() {
     port_byte_out(0x21, 0x04); port_byte_out(0xA1, 0x02);
     port_byte_out(0x21, 0x01); port_byte_out(0xA1, 0x01);
     port_byte_out(0x21, 0xFD); port_byte_out(0xA1, 0xFF);
-    
+
     extern void isr_keyboard();
     set_idt_gate(33, (u32)isr_keyboard);
     set_idt();
     __asm__ volatile("sti");
-}
\ No newline at end of file
+}
@@ -1,4 +1,9 @@
 #ifndef KEYBOARD_H
 #define KEYBOARD_H
+
+#include "../kernel/types.h"
+
 void init_keyboard();
-#endif
\ No newline at end of file
+void keyboard_handle_scancode(u8 scancode);
+void keyboard_inject(u8* scancodes, int count);
+#endif
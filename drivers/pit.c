@@ -0,0 +1,57 @@
+#include "pit.h"
+#include "ports.h"
+#include "../cpu/idt.h"
+#include "../cpu/tsc.h"
+#include "../kernel/timer.h"
+
+// PIT channel 0 at TIMER_HZ on IRQ0, driving system_timers.
+// The kernel often runs with interrupts off (the shell runs inside the
+// keyboard interrupt), and the PIC keeps only one pending IRQ0 however
+// many ticks pass. So once the TSC rate is known (measured over the
+// first ticks), each interrupt also replays the ticks that were missed.
+
+u64 tsc_last_tick = 0;
+u32 tsc_per_tick = 0;
+u32 calibrate_ticks = 0;
+u64 calibrate_start = 0;
+
+void isr_timer_handler() {
+    port_byte_out(0x20, 0x20);
+    u64 now = rdtsc();
+
+    if (!tsc_per_tick) {
+        if (calibrate_ticks == 0) calibrate_start = now;
+        else if (calibrate_ticks == PIT_CALIBRATE_TICKS) {
+            tsc_per_tick = (u32)(now - calibrate_start) / PIT_CALIBRATE_TICKS;
+        }
+        calibrate_ticks++;
+        tsc_last_tick = now;
+        timer_tick(&system_timers);
+        return;
+    }
+
+    timer_tick(&system_timers);
+    tsc_last_tick += tsc_per_tick;
+    while (now >= tsc_last_tick + tsc_per_tick) {
+        timer_tick(&system_timers);
+        tsc_last_tick += tsc_per_tick;
+    }
+}
+
+void init_timer() {
+    u32 divisor = PIT_FREQ / TIMER_HZ;
+    timer_wheel_init(&system_timers);
+
+    port_byte_out(PIT_COMMAND, 0x36); // Channel 0, lo/hi byte, mode 3
+    port_byte_out(PIT_CHANNEL0, (u8)(divisor & 0xFF));
+    port_byte_out(PIT_CHANNEL0, (u8)(divisor >> 8));
+
+    extern void isr_timer();
+    set_idt_gate(32, (u32)isr_timer);
+    set_idt();
+    port_byte_out(0x21, port_byte_in(0x21) & ~0x01); // Unmask IRQ0
+}
+
+u32 uptime_seconds() {
+    return system_timers.ticks / TIMER_HZ;
+}
@@ -0,0 +1,16 @@
+#ifndef PIT_H
+#define PIT_H
+
+#include "../kernel/types.h"
+
+#define PIT_FREQ 1193182     // Input clock, Hz
+#define PIT_CHANNEL0 0x40
+#define PIT_COMMAND 0x43
+#define PIT_CALIBRATE_TICKS 10
+
+extern u32 tsc_per_tick; // 0 until measured over the first ticks
+
+void init_timer();
+u32 uptime_seconds();
+
+#endif
@@ -8,4 +8,13 @@ unsigned char port_byte_in(unsigned short port) {
 
 void port_byte_out(unsigned short port, unsigned char data) {
     __asm__("out %%al, %%dx" : : "a" (data), "d" (port));
-}
\ No newline at end of file
+}
+unsigned short port_word_in(unsigned short port) {
+    unsigned short result;
+    __asm__("in %%dx, %%ax" : "=a" (result) : "d" (port));
+    return result;
+}
+
+void port_word_out(unsigned short port, unsigned short data) {
+    __asm__("out %%ax, %%dx" : : "a" (data), "d" (port));
+}
@@ -1,6 +1,7 @@
 #include "screen.h"
 #include "ports.h"
-#include "../kernel/types.h" // Needed for memory copy
+#include "../kernel/types.h"
+#include "../libc/string.h" // memory_copy
 
 // Private helper functions
 int get_offset(int col, int row) { 
@@ -31,14 +32,6 @@ void set_cursor_offset(int offset) {
     port_byte_out(REG_SCREEN_DATA, (unsigned char)(offset & 0xff));
 }
 
-// --- NEW FUNCTION: Memory Copy Helper ---
-void memory_copy(char *source, char *dest, int nbytes) {
-    int i;
-    for (i = 0; i < nbytes; i++) {
-        *(dest + i) = *(source + i);
-    }
-}
-
 // --- NEW FUNCTION: Handle Scrolling ---
 int handle_scrolling(int cursor_offset) {
     // If the cursor is within the screen, return it unmodified
@@ -77,22 +70,15 @@ void clear_screen() {
     set_cursor_offset(get_offset(0, 0));
 }
 
-void kprint_at(char *message, int col, int row) {
-    int offset;
-    if (col >= 0 && row >= 0)
-        offset = get_offset(col, row);
-    else {
-        offset = get_cursor_offset();
-        row = get_offset_row(offset);
-        col = get_offset_col(offset);
-    }
-
+// Print message at a screen offset without touching the cursor. Returns
+// the offset just after it (the screen may have scrolled meanwhile).
+int kprint_at_offset(char *message, int offset) {
     int i = 0;
     while (message[i] != 0) {
         offset = handle_scrolling(offset); // <--- Check for scroll!
         
         if (message[i] == '\n') {
-            row = get_offset_row(offset);
+            int row = get_offset_row(offset);
             offset = get_offset(0, row + 1);
         } else {
             char *vidmem = (char *)VIDEO_ADDRESS;
@@ -102,8 +88,16 @@ void kprint_at(char *message, int col, int row) {
         }
         i++;
     }
-    offset = handle_scrolling(offset); // <--- Check final scroll
-    set_cursor_offset(offset);
+    return handle_scrolling(offset); // <--- Check final scroll
+}
+
+void kprint_at(char *message, int col, int row) {
+    int offset;
+    if (col >= 0 && row >= 0)
+        offset = get_offset(col, row);
+    else
+        offset = get_cursor_offset();
+    set_cursor_offset(kprint_at_offset(message, offset));
 }
 
 void kprint(char *message) {
@@ -12,6 +12,7 @@
 
 void clear_screen();
 void kprint_at(char *message, int col, int row);
+int kprint_at_offset(char *message, int offset);
 void kprint(char *message);
 void kprint_backspace();
 void kprint_move_cursor(int direction);
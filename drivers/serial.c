@@ -0,0 +1,27 @@
+#include "serial.h"
+#include "ports.h"
+
+void init_serial() {
+    port_byte_out(COM1 + 1, 0x00); // Disable interrupts
+    port_byte_out(COM1 + 3, 0x80); // Enable DLAB to set the baud divisor
+    port_byte_out(COM1 + 0, 0x03); // Divisor 3 -> 38400 baud
+    port_byte_out(COM1 + 1, 0x00);
+    port_byte_out(COM1 + 3, 0x03); // 8 bits, no parity, one stop bit
+    port_byte_out(COM1 + 2, 0xC7); // Enable and clear FIFO
+    port_byte_out(COM1 + 4, 0x0B); // DTR + RTS
+}
+
+void serial_putc(char c) {
+    // Wait until the transmit holding register is empty
+    while ((port_byte_in(COM1 + 5) & 0x20) == 0);
+    port_byte_out(COM1, c);
+}
+
+void serial_print(char *message) {
+    int i = 0;
+    while (message[i] != '\0') {
+        if (message[i] == '\n') serial_putc('\r');
+        serial_putc(message[i]);
+        i++;
+    }
+}
@@ -0,0 +1,9 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#define COM1 0x3f8
+
+void init_serial();
+void serial_putc(char c);
+void serial_print(char *message);
+#endif
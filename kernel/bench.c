@@ -0,0 +1,779 @@
+#include "bench.h"
+#include "fs.h"
+#include "process.h"
+#include "sched.h"
+#include "ipc.h"
+#include "mem.h"
+#include "syscall.h"
+#include "../libc/syscall.h"
+#include "elf.h"
+#include "vm.h"
+#include "timer.h"
+#include "search.h"
+#include "journal.h"
+#include "../cpu/tsc.h"
+#include "../drivers/ports.h"
+#include "../drivers/screen.h"
+#include "../drivers/serial.h"
+#include "../drivers/keyboard.h"
+#include "../drivers/pit.h"
+#include "../libc/string.h"
+
+// Scancodes used to drive the keyboard path
+#define SC_A 0x1E
+#define SC_B 0x30
+#define SC_C 0x2E
+#define SC_BACKSPACE 0x0E
+
+// Emits "BENCH <name> <cycles per op>" on serial (machine readable)
+// and the same line on screen.
+void bench_report(char* name, u32 cycles, int iters) {
+    char buffer[20];
+    uint_to_ascii(cycles / iters, buffer);
+
+    serial_print("BENCH ");
+    serial_print(name);
+    serial_print(" ");
+    serial_print(buffer);
+    serial_print("\n");
+
+    kprint("BENCH ");
+    kprint(name);
+    kprint(" ");
+    kprint(buffer);
+    kprint("\n");
+}
+
+// A throughput ("RATE <name> <per second>"), where higher is better.
+// bench_compare.sh only gates BENCH lines, so these are shown, not compared.
+void bench_rate(char* name, u32 per_second) {
+    char buffer[20];
+    uint_to_ascii(per_second, buffer);
+
+    serial_print("RATE ");
+    serial_print(name);
+    serial_print(" ");
+    serial_print(buffer);
+    serial_print("\n");
+
+    kprint("RATE ");
+    kprint(name);
+    kprint(" ");
+    kprint(buffer);
+    kprint("\n");
+}
+
+void bench_file_name(int i, char* name) {
+    char num[12];
+    strcpy(name, "/bench");
+    int_to_ascii(i, num);
+    strcat(name, num);
+}
+
+void bench_string() {
+    char a[] = "/home/projects/eduos/notes.txt";
+    char b[] = "/home/projects/eduos/notes.txT";
+    char dest[MAX_FILENAME];
+    u64 start;
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_ITERS; i++) strlen(a);
+    bench_report("str_strlen", (u32)(rdtsc() - start), BENCH_ITERS);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_ITERS; i++) strcmp(a, b);
+    bench_report("str_strcmp", (u32)(rdtsc() - start), BENCH_ITERS);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_ITERS; i++) strcasecmp(a, b);
+    bench_report("str_strcasecmp", (u32)(rdtsc() - start), BENCH_ITERS);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_ITERS; i++) strcpy(dest, a);
+    bench_report("str_strcpy", (u32)(rdtsc() - start), BENCH_ITERS);
+}
+
+void bench_console() {
+    int lines = 100;
+    u64 start = rdtsc();
+    for (int i = 0; i < lines; i++) {
+        kprint("The quick brown fox jumps over the lazy dog\n");
+    }
+    bench_report("console_kprint", (u32)(rdtsc() - start), lines);
+}
+
+void bench_fs() {
+    char name[MAX_FILENAME];
+    u64 start;
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_FILES; i++) {
+        bench_file_name(i, name);
+        fs_create(name);
+    }
+    bench_report("fs_create", (u32)(rdtsc() - start), BENCH_FILES);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_FILES; i++) {
+        bench_file_name(i, name);
+        fs_write(name, "benchmark payload");
+    }
+    bench_report("fs_write", (u32)(rdtsc() - start), BENCH_FILES);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_FILES; i++) {
+        bench_file_name(i, name);
+        fs_read(name);
+    }
+    bench_report("fs_lookup", (u32)(rdtsc() - start), BENCH_FILES);
+
+    start = rdtsc();
+    for (int i = 0; i < 4; i++) fs_list();
+    bench_report("fs_list", (u32)(rdtsc() - start), 4);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_FILES; i++) {
+        bench_file_name(i, name);
+        fs_delete(name);
+    }
+    bench_report("fs_delete", (u32)(rdtsc() - start), BENCH_FILES);
+}
+
+// The whole input path (queue, decode, line buffer, screen). Keys one
+// at a time get a screen update each; a burst gets one for all its keys.
+void bench_keyboard() {
+    u8 typed[BENCH_KEY_BURST];
+    u8 erased[BENCH_KEY_BURST];
+    u8 abc[] = { SC_A, SC_B, SC_C, SC_BACKSPACE, SC_BACKSPACE, SC_BACKSPACE };
+    int rounds = 50;
+
+    u64 start = rdtsc();
+    // Type "abc" and erase it again, so the line buffer ends up unchanged
+    for (int i = 0; i < rounds; i++) {
+        for (int k = 0; k < 6; k++) keyboard_inject(&abc[k], 1);
+    }
+    bench_report("kbd_scancode", (u32)(rdtsc() - start), rounds * 6);
+
+    for (int k = 0; k < BENCH_KEY_BURST; k++) {
+        typed[k] = abc[k % 3];
+        erased[k] = SC_BACKSPACE;
+    }
+    start = rdtsc();
+    for (int i = 0; i < rounds; i++) {
+        keyboard_inject(typed, BENCH_KEY_BURST);
+        keyboard_inject(erased, BENCH_KEY_BURST);
+    }
+    u32 cycles = (u32)(rdtsc() - start);
+    int keys = rounds * 2 * BENCH_KEY_BURST;
+    bench_report("kbd_burst", cycles, keys);
+    // Sustained rate, once the PIT has measured the TSC
+    u32 per_key = cycles / keys;
+    if (tsc_per_tick && per_key) bench_rate("kbd_keys_per_sec", tsc_per_tick / per_key * TIMER_HZ);
+}
+
+void bench_process() {
+    u64 start = rdtsc();
+    int first = create_process("Bench", 0);
+    for (int i = 1; i < BENCH_PROCESSES; i++) create_process("Bench", 0);
+    bench_report("proc_create", (u32)(rdtsc() - start), BENCH_PROCESSES);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_PROCESSES; i++) find_process(first + i);
+    bench_report("proc_lookup", (u32)(rdtsc() - start), BENCH_PROCESSES);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_PROCESSES; i++) {
+        kill_process(first + i);
+        wait_process(first + i);
+    }
+    bench_report("proc_kill_wait", (u32)(rdtsc() - start), BENCH_PROCESSES);
+}
+
+// --- IPC: threads talking through pipes and message queues ---
+
+pipe_t* bench_ping;
+pipe_t* bench_pong;
+mqueue_t* bench_mq;
+u64 bench_start;
+u64 bench_end;
+
+void bench_pinger(void* arg) {
+    char c = 'x';
+    bench_start = rdtsc();
+    for (int i = 0; i < BENCH_PINGPONG; i++) {
+        pipe_write(bench_ping, &c, 1);
+        pipe_read(bench_pong, &c, 1);
+    }
+    bench_end = rdtsc();
+    pipe_close_writer(bench_ping);
+    pipe_close_reader(bench_pong);
+}
+
+void bench_ponger(void* arg) {
+    char c;
+    while (pipe_read(bench_ping, &c, 1) == 1) pipe_write(bench_pong, &c, 1);
+    pipe_close_reader(bench_ping);
+    pipe_close_writer(bench_pong);
+}
+
+void bench_pipe_writer(void* arg) {
+    char chunk[BENCH_PIPE_CHUNK];
+    for (int i = 0; i < BENCH_PIPE_CHUNK; i++) chunk[i] = (char)i;
+    bench_start = rdtsc();
+    for (int sent = 0; sent < BENCH_PIPE_BYTES; sent += BENCH_PIPE_CHUNK) {
+        pipe_write(bench_ping, chunk, BENCH_PIPE_CHUNK);
+    }
+    pipe_close_writer(bench_ping);
+}
+
+void bench_pipe_reader(void* arg) {
+    char chunk[BENCH_PIPE_CHUNK];
+    while (pipe_read(bench_ping, chunk, BENCH_PIPE_CHUNK) > 0);
+    bench_end = rdtsc();
+    pipe_close_reader(bench_ping);
+}
+
+// Full pages handed over by ownership transfer, not copied
+void bench_mq_sender(void* arg) {
+    bench_start = rdtsc();
+    for (int i = 0; i < BENCH_MQ_MESSAGES; i++) {
+        char* page = (char*)proc_page_alloc(current);
+        if (!page) break;
+        page[0] = (char)i;
+        mq_send_page(bench_mq, page, PAGE_SIZE);
+    }
+    mq_send(bench_mq, "", 0); // End marker
+}
+
+void bench_mq_receiver(void* arg) {
+    message_t msg;
+    while (mq_receive(bench_mq, &msg) == 0 && msg.page) {
+        proc_page_free(current, msg.page);
+    }
+    bench_end = rdtsc();
+}
+
+void bench_run_pair(thread_entry_t a, thread_entry_t b) {
+    int pid_a = create_thread("bench-a", a, 0);
+    int pid_b = create_thread("bench-b", b, 0);
+    if (pid_a) sched_join(pid_a);
+    if (pid_b) sched_join(pid_b);
+}
+
+void bench_ipc() {
+    bench_ping = pipe_create();
+    bench_pong = pipe_create();
+    if (bench_ping && bench_pong) {
+        bench_run_pair(bench_pinger, bench_ponger);
+        bench_report("ipc_pingpong_rtt", (u32)(bench_end - bench_start), BENCH_PINGPONG);
+    }
+
+    bench_ping = pipe_create();
+    if (bench_ping) {
+        bench_run_pair(bench_pipe_writer, bench_pipe_reader);
+        bench_report("ipc_pipe_per_kb", (u32)(bench_end - bench_start), BENCH_PIPE_BYTES / 1024);
+    }
+
+    bench_mq = mq_create();
+    if (bench_mq) {
+        bench_run_pair(bench_mq_sender, bench_mq_receiver);
+        bench_report("ipc_mq_page", (u32)(bench_end - bench_start), BENCH_MQ_MESSAGES);
+        mq_destroy(bench_mq);
+    }
+}
+
+// --- System calls: null call round trip from ring 3 ---
+
+int bench_use_sysenter;
+
+// Runs in ring 3; the result goes back through bench_start/bench_end
+void bench_user_null_syscalls() {
+    bench_start = rdtsc();
+    for (int i = 0; i < BENCH_SYSCALLS; i++) {
+        if (bench_use_sysenter) syscall_sysenter(SYS_NULL, 0, 0, 0);
+        else syscall_int80(SYS_NULL, 0, 0, 0);
+    }
+    bench_end = rdtsc();
+}
+
+void bench_syscall_path(char* name, int use_sysenter) {
+    bench_use_sysenter = use_sysenter;
+    bench_start = bench_end = 0;
+    int pid = create_user_thread("bench-user", bench_user_null_syscalls);
+    if (pid && sched_join(pid)) {
+        bench_report(name, (u32)(bench_end - bench_start), BENCH_SYSCALLS);
+    }
+}
+
+void bench_syscall() {
+    if (syscall_fast) bench_syscall_path("syscall_null_sysenter", 1);
+    bench_syscall_path("syscall_null_int80", 0);
+}
+
+// --- Programs: launching /bin/spin several times at once ---
+
+// elf_exec: the loader alone (nothing is paged in yet)
+// elf_startup: from exec until every instance is running its main()
+// elf_rss_kb: resident size per instance while all are alive
+// elf_faults: page faults per instance over its whole life
+// elf_run: launch to exit
+void bench_elf() {
+    int pids[BENCH_ELF_INSTANCES];
+    int started = 0;
+    u32 faults = vm_faults;
+
+    u64 start = rdtsc();
+    while (started < BENCH_ELF_INSTANCES && (pids[started] = elf_exec("/bin/spin")) != 0) started++;
+    u64 loaded = rdtsc();
+    if (started == 0) return;
+
+    // Every instance runs until its sys_yield(), then we get the CPU back
+    schedule();
+    u64 running = rdtsc();
+    u32 rss = 0;
+    for (int i = 0; i < started; i++) {
+        Process* p = find_process(pids[i]);
+        if (p) rss += p->pages * (PAGE_SIZE / 1024);
+    }
+
+    for (int i = 0; i < started; i++) sched_join(pids[i]);
+    u64 end = rdtsc();
+
+    bench_report("elf_exec", (u32)(loaded - start), started);
+    bench_report("elf_startup", (u32)(running - start), started);
+    bench_report("elf_rss_kb", rss, started);
+    bench_report("elf_faults", vm_faults - faults, started);
+    bench_report("elf_run", (u32)(end - start), started);
+}
+
+// --- Timer wheel: a private wheel, advanced by hand ---
+
+timer_wheel_t bench_wheel;
+u32 bench_fired;
+
+void bench_timer_fire(void* arg) {
+    bench_fired++;
+}
+
+void bench_timer() {
+    u32 pages = PAGE_ALIGN_UP(BENCH_TIMERS * sizeof(ktimer_t)) / PAGE_SIZE;
+    ktimer_t* timers = (ktimer_t*)page_alloc_contig(pages);
+    if (!timers) return;
+    timer_wheel_init(&bench_wheel);
+    bench_fired = 0;
+
+    u32 seed = 12345;
+    u64 start = rdtsc();
+    for (int i = 0; i < BENCH_TIMERS; i++) {
+        seed = seed * 1103515245 + 12345;
+        timer_init(&timers[i], bench_timer_fire, 0);
+        timer_add(&bench_wheel, &timers[i], (seed >> 8) % BENCH_TIMER_SPAN + 1);
+    }
+    bench_report("timer_insert", (u32)(rdtsc() - start), BENCH_TIMERS);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_TIMERS; i += 2) timer_cancel(&timers[i]);
+    bench_report("timer_cancel", (u32)(rdtsc() - start), BENCH_TIMERS / 2);
+
+    // Includes the cost of ticking through empty slots
+    start = rdtsc();
+    while (bench_wheel.count > 0) timer_tick(&bench_wheel);
+    bench_report("timer_expiry", (u32)(rdtsc() - start), bench_fired ? bench_fired : 1);
+
+    for (u32 i = 0; i < pages; i++) page_free((char*)timers + i * PAGE_SIZE);
+}
+
+// --- grep: full scan against the trigram index ---
+
+char* bench_words[] = { "kernel ", "page ", "thread ", "pipe ", "timer ", "file ", "\n" };
+
+// Fill buf with len bytes of pseudo-random words
+void bench_text(u32 seed, char* buf, int len) {
+    int pos = 0;
+    while (pos < len) {
+        seed = seed * 1103515245 + 12345;
+        char* w = bench_words[(seed >> 16) % 7];
+        while (*w && pos < len) buf[pos++] = *w++;
+    }
+}
+
+// Every free file slot gets a full file of text; one of them also holds
+// BENCH_NEEDLE. Each query reports cycles per grep over all of them.
+void bench_search() {
+    char name[MAX_FILENAME];
+    char* text = (char*)page_alloc();
+    if (!text) return;
+    int old_quiet = fs_quiet;
+    int old_index = index_enabled;
+    fs_quiet = 1;
+    index_enable(0);
+
+    int files = 0;
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!file_system[i].used) files++;
+    }
+    for (int i = 0; i < files; i++) {
+        bench_file_name(i, name);
+        fs_create(name);
+        bench_text(i, text, MAX_FILESIZE);
+        if (i == 1) memory_copy(BENCH_NEEDLE, text + MAX_FILESIZE / 2, strlen(BENCH_NEEDLE));
+        fs_write_data(name, text, MAX_FILESIZE);
+    }
+
+    u64 start = rdtsc();
+    for (int i = 0; i < BENCH_QUERIES; i++) search_grep(BENCH_NEEDLE, "/", 1);
+    bench_report("grep_scan", (u32)(rdtsc() - start), BENCH_QUERIES);
+
+    start = rdtsc();
+    index_enable(1);
+    bench_report("grep_index_build", (u32)(rdtsc() - start), files ? files : 1);
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_QUERIES; i++) search_grep(BENCH_NEEDLE, "/", 1);
+    bench_report("grep_index", (u32)(rdtsc() - start), BENCH_QUERIES);
+
+    for (int i = 0; i < files; i++) {
+        bench_file_name(i, name);
+        fs_delete(name);
+    }
+    index_enable(old_index);
+    fs_quiet = old_quiet;
+    page_free(text);
+}
+
+// --- Journal: small metadata operations, committed one by one or grouped ---
+
+void bench_journal_ops(char* name, int group) {
+    journal_group = group;
+    u64 start = rdtsc();
+    for (int i = 0; i < BENCH_JOURNAL_OPS / 2; i++) {
+        fs_create("/jbench");
+        fs_delete("/jbench");
+    }
+    journal_commit();
+    bench_report(name, (u32)(rdtsc() - start), BENCH_JOURNAL_OPS);
+}
+
+void bench_journal() {
+    if (!journal_dev) return; // No disk
+    int old_quiet = fs_quiet;
+    int old_group = journal_group;
+    fs_quiet = 1;
+    journal_commit();
+    bench_journal_ops("journal_op_sync", 1);
+    bench_journal_ops("journal_op_group", JOURNAL_GROUP);
+    journal_group = old_group;
+    fs_quiet = old_quiet;
+}
+
+// --- Compressed storage: ratio and throughput on English text ---
+
+// File i is MAX_FILESIZE bytes of this, starting at i * BENCH_CORPUS_STEP
+// (wrapping around), so every file is different prose
+char bench_corpus[] =
+    "EduOS is a small educational operating system for 32-bit x86 machines. "
+    "It boots from a floppy image through a two-stage boot loader, switches the "
+    "processor into protected mode and jumps to a kernel written in C. The kernel "
+    "sets up its own descriptor tables, remaps the interrupt controller and starts "
+    "taking keyboard and timer interrupts. Everything the user sees happens in a "
+    "simple shell: files are created and listed, programs are started and stopped, "
+    "and the memory map reported by the BIOS can be inspected.\n"
+    "Files live in a flat table held in memory, with directories expressed as "
+    "path prefixes. The table can be kept on a second disk, where a write-ahead "
+    "journal makes every change to it atomic: after a crash the system comes back "
+    "with the table as it was at the last commit, never with half an update. "
+    "Contents are written in place before the commit that refers to them.\n"
+    "Processes are kernel threads scheduled cooperatively. Each one owns its "
+    "stack and any pages it allocated, and all of it is returned when the process "
+    "is reaped. Programs in ELF format run in ring three with their own address "
+    "space; their pages are filled in on first touch by the page fault handler, "
+    "and the read-only text of a program is shared between its instances.\n"
+    "Pipes connect the stages of a shell pipeline, message queues carry fixed "
+    "size messages between threads, and a timing wheel driven by the interval "
+    "timer wakes sleeping threads and runs periodic work. A benchmark suite "
+    "measures each of these paths in cycles per operation.\n";
+
+void bench_compress_write(char* name, char* text, int files) {
+    char fname[MAX_FILENAME];
+    int len = sizeof(bench_corpus) - 1;
+    u64 start = rdtsc();
+    for (int r = 0; r < BENCH_COMPRESS_ROUNDS; r++) {
+        for (int i = 0; i < files; i++) {
+            bench_file_name(i, fname);
+            fs_write_data(fname, text + (i * BENCH_CORPUS_STEP) % len, MAX_FILESIZE);
+        }
+    }
+    bench_report(name, (u32)(rdtsc() - start), BENCH_COMPRESS_ROUNDS * files);
+}
+
+// Whole-file reads, as sys_read does them. Going round all files misses
+// the decompressed cache every time; reading one file hits it.
+void bench_compress_read(char* name, char* buf, int files) {
+    char fname[MAX_FILENAME];
+    File* f[MAX_FILES];
+    for (int i = 0; i < files; i++) {
+        bench_file_name(i, fname);
+        f[i] = fs_find(fname);
+    }
+    u64 start = rdtsc();
+    for (int r = 0; r < BENCH_COMPRESS_ROUNDS; r++) {
+        for (int i = 0; i < files; i++) memory_copy(fs_data(f[i]), buf, f[i]->size);
+    }
+    bench_report(name, (u32)(rdtsc() - start), BENCH_COMPRESS_ROUNDS * files);
+}
+
+void bench_compress() {
+    char name[MAX_FILENAME];
+    char* text = (char*)page_alloc();
+    if (!text) return;
+    int len = sizeof(bench_corpus) - 1;
+    memory_copy(bench_corpus, text, len);
+    memory_copy(bench_corpus, text + len, len);
+
+    // Storage cost only: the disk (if any) is left out and sees no change
+    blockdev_t* dev = journal_dev;
+    journal_commit();
+    journal_dev = 0;
+    int old_quiet = fs_quiet;
+    int old_index = index_enabled;
+    int old_compress = fs_compress;
+    fs_quiet = 1;
+    index_enable(0);
+
+    int files = 0;
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!file_system[i].used) files++;
+    }
+    if (files > BENCH_COMPRESS_FILES) files = BENCH_COMPRESS_FILES;
+    for (int i = 0; i < files; i++) {
+        bench_file_name(i, name);
+        fs_create(name);
+    }
+
+    fs_compress = 0;
+    bench_compress_write("fs_write_raw", text, files);
+    bench_compress_read("fs_read_raw", text, files);
+    fs_compress = 1;
+    bench_compress_write("fs_write_lz", text, files);
+    bench_compress_read("fs_read_lz", text, files);
+    bench_compress_read("fs_read_lz_cached", text, 1);
+
+    // Stored size as a percentage of the raw size
+    u32 raw = 0, stored = 0;
+    for (int i = 0; i < files; i++) {
+        bench_file_name(i, name);
+        File* f = fs_find(name);
+        raw += f->size;
+        stored += f->stored;
+    }
+    bench_report("fs_lz_ratio_pct", raw ? stored * 100 / raw : 0, 1);
+
+    for (int i = 0; i < files; i++) {
+        bench_file_name(i, name);
+        fs_delete(name);
+    }
+    fs_compress = old_compress;
+    index_enable(old_index);
+    fs_quiet = old_quiet;
+    journal_dev = dev;
+    page_free(text);
+}
+
+// --- File mappings: repeated scans through mmap versus sys_read ---
+
+// A file holds at most MAX_FILESIZE bytes, so the large file scanned here
+// is BENCH_MMAP_FILES full files (bench_corpus text) taken one after the
+// other. The scans run in a kernel thread with an address space of its
+// own, so mapped pages are demand faulted exactly as in a program.
+// mmap_map: SYS_MMAP, per file
+// mmap_fault: first touch of a mapping (fills the shared cache), per file
+// read_seq, mmap_seq: summing every byte of a file, per file
+// read_rand, mmap_rand: one byte of a random file at a random offset
+// mmap_cow: first write to a private mapping (copies the page), per file
+// mmap_msync: one byte changed through a shared mapping, then SYS_MSYNC
+char bench_mmap_name[BENCH_MMAP_FILES][MAX_FILENAME];
+int bench_mmap_count;
+volatile u32 bench_sink;
+
+u32 bench_sum(char* data, int len) {
+    u32 sum = 0;
+    for (int i = 0; i < len; i++) sum += (u8)data[i];
+    return sum;
+}
+
+// Map every file; 0 if any mapping failed
+int bench_mmap_all(char** maps, u32 flags) {
+    for (int i = 0; i < bench_mmap_count; i++) {
+        maps[i] = (char*)syscall_dispatch(SYS_MMAP, (u32)bench_mmap_name[i], flags, 0);
+        if (!maps[i]) return 0;
+    }
+    return 1;
+}
+
+void bench_munmap_all(char** maps) {
+    for (int i = 0; i < bench_mmap_count; i++) {
+        if (maps[i]) syscall_dispatch(SYS_MUNMAP, (u32)maps[i], 0, 0);
+    }
+}
+
+void bench_mmap_scans(void* arg) {
+    char* maps[BENCH_MMAP_FILES];
+    int files = bench_mmap_count;
+    char* buf = (char*)proc_page_alloc(current);
+    if (!buf) return;
+
+    u64 start = rdtsc();
+    for (int r = 0; r < BENCH_MMAP_ROUNDS; r++) {
+        for (int i = 0; i < files; i++) {
+            int n = syscall_dispatch(SYS_READ, (u32)bench_mmap_name[i], (u32)buf, MAX_FILESIZE + 1);
+            bench_sink += bench_sum(buf, n);
+        }
+    }
+    bench_report("read_seq", (u32)(rdtsc() - start), BENCH_MMAP_ROUNDS * files);
+
+    start = rdtsc();
+    int mapped = bench_mmap_all(maps, 0);
+    u64 faulted = rdtsc();
+    if (!mapped) {
+        bench_munmap_all(maps);
+        return;
+    }
+    for (int i = 0; i < files; i++) bench_sink += maps[i][0];
+    u64 end = rdtsc();
+    bench_report("mmap_map", (u32)(faulted - start), files);
+    bench_report("mmap_fault", (u32)(end - faulted), files);
+
+    start = rdtsc();
+    for (int r = 0; r < BENCH_MMAP_ROUNDS; r++) {
+        for (int i = 0; i < files; i++) bench_sink += bench_sum(maps[i], MAX_FILESIZE);
+    }
+    bench_report("mmap_seq", (u32)(rdtsc() - start), BENCH_MMAP_ROUNDS * files);
+
+    // Same probe sequence for both
+    u32 seed = 1;
+    start = rdtsc();
+    for (int i = 0; i < BENCH_MMAP_PROBES; i++) {
+        seed = seed * 1103515245 + 12345;
+        int f = (seed >> 16) % files;
+        syscall_dispatch(SYS_READ, (u32)bench_mmap_name[f], (u32)buf, MAX_FILESIZE + 1);
+        bench_sink += buf[(seed >> 4) % MAX_FILESIZE];
+    }
+    bench_report("read_rand", (u32)(rdtsc() - start), BENCH_MMAP_PROBES);
+
+    seed = 1;
+    start = rdtsc();
+    for (int i = 0; i < BENCH_MMAP_PROBES; i++) {
+        seed = seed * 1103515245 + 12345;
+        bench_sink += maps[(seed >> 16) % files][(seed >> 4) % MAX_FILESIZE];
+    }
+    bench_report("mmap_rand", (u32)(rdtsc() - start), BENCH_MMAP_PROBES);
+    bench_munmap_all(maps);
+
+    if (bench_mmap_all(maps, MMAP_WRITE)) {
+        for (int i = 0; i < files; i++) bench_sink += maps[i][0]; // Shared until written
+        start = rdtsc();
+        for (int i = 0; i < files; i++) maps[i][0] = '#';
+        bench_report("mmap_cow", (u32)(rdtsc() - start), files);
+    }
+    bench_munmap_all(maps);
+
+    if (bench_mmap_all(maps, MMAP_WRITE | MMAP_SHARED)) {
+        start = rdtsc();
+        for (int i = 0; i < files; i++) {
+            maps[i][0] = '#';
+            syscall_dispatch(SYS_MSYNC, (u32)maps[i], 0, 0);
+        }
+        bench_report("mmap_msync", (u32)(rdtsc() - start), files);
+    }
+    bench_munmap_all(maps);
+}
+
+void bench_mmap() {
+    if (!paging_enabled) return;
+    char* text = (char*)page_alloc();
+    if (!text) return;
+    int len = sizeof(bench_corpus) - 1;
+    memory_copy(bench_corpus, text, len);
+    memory_copy(bench_corpus, text + len, len);
+
+    // As in bench_compress: the disk is left out
+    blockdev_t* dev = journal_dev;
+    journal_commit();
+    journal_dev = 0;
+    int old_quiet = fs_quiet;
+    int old_index = index_enabled;
+    fs_quiet = 1;
+    index_enable(0);
+
+    bench_mmap_count = 0;
+    for (int i = 0; i < MAX_FILES && bench_mmap_count < BENCH_MMAP_FILES; i++) {
+        if (!file_system[i].used) bench_mmap_count++;
+    }
+    for (int i = 0; i < bench_mmap_count; i++) {
+        bench_file_name(i, bench_mmap_name[i]);
+        fs_create(bench_mmap_name[i]);
+        fs_write_data(bench_mmap_name[i], text + (i * BENCH_CORPUS_STEP) % len, MAX_FILESIZE);
+    }
+
+    int pid = bench_mmap_count ? create_thread("bench-mmap", bench_mmap_scans, 0) : 0;
+    if (pid) {
+        if (vm_create(find_process(pid))) sched_join(pid);
+        else {
+            kill_process(pid);
+            wait_process(pid);
+        }
+    }
+
+    for (int i = 0; i < bench_mmap_count; i++) fs_delete(bench_mmap_name[i]);
+    index_enable(old_index);
+    fs_quiet = old_quiet;
+    journal_dev = dev;
+    page_free(text);
+}
+
+// Endless file churn for the crash test: every operation kind the journal
+// covers, on a few names, so that a crash can hit any of them
+void fs_stress() {
+    char name[MAX_FILENAME];
+    char other[MAX_FILENAME];
+    char text[24];
+    fs_quiet = 1;
+    if (!fs_find("/stress")) fs_mkdir("/stress");
+    for (u32 i = 0;; i++) {
+        strcpy(name, "/stress/a");
+        int_to_ascii(i % 8, text);
+        strcat(name, text);
+        strcpy(other, name);
+        other[8] = 'b';
+
+        if (fs_find(other)) fs_delete(other);
+        if (!fs_find(name)) fs_create(name);
+        uint_to_ascii(i, text);
+        fs_write(name, text);
+        fs_rename(name, other);
+        if (i % 3 == 0) fs_copy(other, name);
+    }
+}
+
+void run_benchmarks() {
+    serial_print("BENCH_START\n");
+    bench_string();
+    bench_console();
+    bench_fs();
+    bench_keyboard();
+    bench_process();
+    bench_ipc();
+    bench_syscall();
+    bench_elf();
+    bench_timer();
+    bench_search();
+    bench_journal();
+    bench_compress();
+    bench_mmap();
+    serial_print("BENCH_DONE\n");
+}
+
+// QEMU exits with status (code << 1) | 1
+void qemu_exit(u8 code) {
+    port_byte_out(QEMU_EXIT_PORT, code);
+}
@@ -0,0 +1,37 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "types.h"
+
+// isa-debug-exit device (QEMU: -device isa-debug-exit,iobase=0xf4,iosize=0x04)
+#define QEMU_EXIT_PORT 0xf4
+
+#define BENCH_ITERS 1000
+#define BENCH_FILES 8
+#define BENCH_KEY_BURST 32 // Keys per burst, well under the key queue
+#define BENCH_PROCESSES 1000
+#define BENCH_PINGPONG 1000
+#define BENCH_PIPE_BYTES (256 * 1024)
+#define BENCH_PIPE_CHUNK 1024
+#define BENCH_MQ_MESSAGES 256
+#define BENCH_SYSCALLS 10000
+#define BENCH_ELF_INSTANCES 8
+#define BENCH_TIMERS 4096
+#define BENCH_TIMER_SPAN 10000 // Ticks: spread over all wheel levels but the last
+#define BENCH_QUERIES 100
+#define BENCH_NEEDLE "quasar"
+#define BENCH_JOURNAL_OPS 64
+#define BENCH_COMPRESS_FILES 8  // Twice the decompressed cache
+#define BENCH_COMPRESS_ROUNDS 16
+#define BENCH_CORPUS_STEP 211
+#define BENCH_MMAP_FILES 8
+#define BENCH_MMAP_ROUNDS 16
+#define BENCH_MMAP_PROBES 1024
+
+void run_benchmarks();
+void bench_report(char* name, u32 cycles, int iters);
+void bench_rate(char* name, u32 per_second);
+void qemu_exit(u8 code);
+void fs_stress();
+
+#endif
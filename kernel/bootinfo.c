@@ -0,0 +1,109 @@
+#include "bootinfo.h"
+#include "../drivers/screen.h"
+#include "../drivers/serial.h"
+#include "../libc/string.h"
+#include "../cpu/tsc.h"
+
+boot_phase_t boot_phases[BOOT_PHASES_MAX];
+int boot_phase_count = 0;
+
+// Called first thing in kernel_main: the bootloader phase comes from the
+// timestamps stage 2 left in the boot info block.
+void boot_timing_start() {
+    boot_phases[0].name = "bootloader";
+    boot_phases[0].end = boot_info->tsc_loaded;
+    boot_phase_count = 1;
+    boot_mark("pm_switch");
+}
+
+// End the current phase now
+void boot_mark(char* name) {
+    if (boot_phase_count >= BOOT_PHASES_MAX) return;
+    boot_phases[boot_phase_count].name = name;
+    boot_phases[boot_phase_count].end = rdtsc();
+    boot_phase_count++;
+}
+
+u32 boot_phase_cycles(int i) {
+    u64 start = (i == 0) ? boot_info->tsc_stage2 : boot_phases[i-1].end;
+    return (u32)(boot_phases[i].end - start);
+}
+
+void boot_serial_line(char* name, u32 value) {
+    char buffer[20];
+    uint_to_ascii(value, buffer);
+    serial_print("BOOT ");
+    serial_print(name);
+    serial_print(" ");
+    serial_print(buffer);
+    serial_print("\n");
+}
+
+// Cycles from stage 2 until the "prompt" mark
+u32 boot_cycles_to_prompt() {
+    for (int i = 0; i < boot_phase_count; i++) {
+        if (strcmp(boot_phases[i].name, "prompt") == 0) {
+            return (u32)(boot_phases[i].end - boot_info->tsc_stage2);
+        }
+    }
+    return 0;
+}
+
+// Kernel size and phase times on serial, as "BOOT <name> <value>" lines
+void boot_report() {
+    boot_serial_line("kernel_bytes", boot_info->kernel_bytes);
+    for (int i = 0; i < boot_phase_count; i++) {
+        boot_serial_line(boot_phases[i].name, boot_phase_cycles(i));
+    }
+    boot_serial_line("to_prompt", boot_cycles_to_prompt());
+}
+
+// "boottime": cycles spent in each phase, stage 2 onwards
+void boot_print_times() {
+    char buffer[20];
+    kprint("\nPHASE                | CYCLES\n");
+    kprint("------------------------------\n");
+    for (int i = 0; i < boot_phase_count; i++) {
+        kprint(boot_phases[i].name);
+        for (int pad = strlen(boot_phases[i].name); pad < 21; pad++) kprint(" ");
+        kprint("| ");
+        uint_to_ascii(boot_phase_cycles(i), buffer);
+        kprint(buffer);
+        kprint("\n");
+    }
+    kprint("Time to prompt: ");
+    uint_to_ascii(boot_cycles_to_prompt(), buffer);
+    kprint(buffer);
+    kprint(" cycles\n\n");
+}
+
+// "meminfo": the E820 map collected by the bootloader
+void boot_print_mmap() {
+    char buffer[20];
+    u32 usable_kb = 0;
+
+    kprint("\nBASE               | LENGTH (KB) | TYPE\n");
+    kprint("----------------------------------------\n");
+    for (u32 i = 0; i < boot_info->mmap_count; i++) {
+        mmap_entry_t* e = &boot_info->mmap[i];
+        u32 length_kb = (e->length_low >> 10) | (e->length_high << 22);
+
+        hex_to_ascii(e->base_high, buffer);
+        kprint(buffer);
+        hex_to_ascii(e->base_low, buffer);
+        kprint(buffer + 2);
+        kprint(" | ");
+        uint_to_ascii(length_kb, buffer);
+        kprint(buffer);
+        kprint(" | ");
+        kprint(e->type == MMAP_USABLE ? "usable\n" : "reserved\n");
+
+        if (e->type == MMAP_USABLE) usable_kb += length_kb;
+    }
+    if (boot_info->mmap_count == 0) kprint("(BIOS gave no E820 map)\n");
+
+    kprint("Usable: ");
+    uint_to_ascii(usable_kb, buffer);
+    kprint(buffer);
+    kprint(" KB\n\n");
+}
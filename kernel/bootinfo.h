@@ -0,0 +1,51 @@
+#ifndef BOOTINFO_H
+#define BOOTINFO_H
+
+#include "types.h"
+
+// Filled in by boot/stage2.asm before entering protected mode.
+// Layout must match the BI_* offsets there.
+#define BOOT_INFO_ADDR 0x500
+#define MMAP_MAX 32
+
+// E820 region types
+#define MMAP_USABLE   1
+#define MMAP_RESERVED 2
+
+typedef struct {
+    u32 base_low;
+    u32 base_high;
+    u32 length_low;
+    u32 length_high;
+    u32 type;
+    u32 acpi;
+} __attribute__((packed)) mmap_entry_t;
+
+typedef struct {
+    u32 boot_drive;
+    u32 kernel_bytes;   // Size of the loaded image
+    u32 mmap_count;
+    u32 reserved;
+    u64 tsc_stage2;     // rdtsc when stage 2 started
+    u64 tsc_loaded;     // rdtsc when the kernel was in place
+    u8 pad[32];
+    mmap_entry_t mmap[MMAP_MAX];
+} __attribute__((packed)) boot_info_t;
+
+#define boot_info ((boot_info_t*)BOOT_INFO_ADDR)
+
+#define BOOT_PHASES_MAX 10
+
+// One boot phase; it ran from the previous phase's end up to 'end'
+typedef struct {
+    char* name;
+    u64 end;
+} boot_phase_t;
+
+void boot_timing_start();
+void boot_mark(char* name);
+void boot_report();
+void boot_print_times();
+void boot_print_mmap();
+
+#endif
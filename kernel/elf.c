@@ -0,0 +1,101 @@
+#include "elf.h"
+#include "vm.h"
+#include "fs.h"
+#include "sched.h"
+#include "mem.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+// ELF32 program loader. Nothing is copied at load time: every PT_LOAD
+// segment becomes an area of the new address space, and its pages are
+// read from the file when the program first touches them (vm.c).
+
+void enter_user_mode(u32 eip, u32 esp); // cpu/syscall.asm
+
+// Programs built with the kernel (user/*.c, see the makefile)
+extern char _binary_user_hello_elf_start[], _binary_user_hello_elf_end[];
+extern char _binary_user_spin_elf_start[], _binary_user_spin_elf_end[];
+extern char _binary_user_maptest_elf_start[], _binary_user_maptest_elf_end[];
+
+// Runs on the new thread's kernel stack, in its address space
+void elf_thread_start(void* entry) {
+    enter_user_mode((u32)entry, USER_STACK_TOP);
+}
+
+int elf_check_header(File* f) {
+    elf_header_t* h = (elf_header_t*)fs_data(f);
+    u32 size = fs_data_size(f);
+    if (size < sizeof(elf_header_t)) return 0;
+    if (*(u32*)h->ident != ELF_MAGIC) return 0;
+    if (h->ident[4] != ELF_CLASS32 || h->ident[5] != ELF_DATA_LSB) return 0;
+    if (h->type != ET_EXEC || h->machine != EM_386) return 0;
+    if (h->phentsize != sizeof(elf_phdr_t)) return 0;
+    if (h->phoff > size || h->phnum > (size - h->phoff) / sizeof(elf_phdr_t)) return 0;
+    return h->entry >= USER_BASE && h->entry < USER_STACK_TOP - USER_STACK_SIZE;
+}
+
+// One area per PT_LOAD segment; read-only ones are shared between instances
+int elf_map_segments(Process* p, File* f) {
+    char* data = fs_data(f);
+    u32 size = fs_data_size(f);
+    elf_header_t* h = (elf_header_t*)data;
+    elf_phdr_t* ph = (elf_phdr_t*)(data + h->phoff);
+    for (int i = 0; i < h->phnum; i++, ph++) {
+        if (ph->type != PT_LOAD || ph->memsz == 0) continue;
+        u32 end = ph->vaddr + ph->memsz;
+        if (ph->vaddr < USER_BASE || end < ph->vaddr || end > USER_STACK_TOP - USER_STACK_SIZE) return 0;
+        if (ph->filesz > ph->memsz || ph->offset > size || ph->filesz > size - ph->offset) return 0;
+
+        u32 flags = (ph->flags & PF_W) ? VM_WRITE : 0;
+        if (!vm_add_area(p, ph->vaddr & ~(PAGE_SIZE - 1), PAGE_ALIGN_UP(end), flags, f,
+                         ph->vaddr, ph->vaddr + ph->filesz, ph->offset)) return 0;
+    }
+    return p->areas != 0;
+}
+
+// Start the program in file path as a new process. Returns its PID, or 0.
+int elf_exec(char* path) {
+    if (!paging_enabled) {
+        kprint("Error: Paging is off, cannot run programs.\n");
+        return 0;
+    }
+    File* f = fs_find(path);
+    if (!f || f->type == FS_DIR) {
+        kprint("Error: Program not found.\n");
+        return 0;
+    }
+    if (!elf_check_header(f)) {
+        kprint("Error: Not an executable.\n");
+        return 0;
+    }
+
+    // Process name: last path component
+    char* name = path;
+    for (char* c = path; *c; c++) if (*c == '/' && c[1]) name = c + 1;
+
+    elf_header_t* h = (elf_header_t*)fs_data(f);
+    int pid = create_thread(name, elf_thread_start, (void*)h->entry);
+    if (!pid) return 0;
+    Process* p = find_process(pid);
+    if (!vm_create(p) || !elf_map_segments(p, f)
+        || !vm_add_area(p, USER_STACK_TOP - USER_STACK_SIZE, USER_STACK_TOP, VM_WRITE, 0, 0, 0, 0)) {
+        kprint("Error: Bad executable or out of memory.\n");
+        kill_process(pid);
+        wait_process(pid);
+        return 0;
+    }
+    return pid;
+}
+
+// Programs kept on disk from an earlier boot are replaced
+void elf_install(char* path, char* start, char* end) {
+    if (fs_find(path) || fs_create(path)) fs_write_data(path, start, end - start);
+}
+
+// Put the built-in programs in /bin
+void elf_install_programs() {
+    if (!fs_find("/bin")) fs_mkdir("/bin");
+    elf_install("/bin/hello", _binary_user_hello_elf_start, _binary_user_hello_elf_end);
+    elf_install("/bin/spin", _binary_user_spin_elf_start, _binary_user_spin_elf_end);
+    elf_install("/bin/maptest", _binary_user_maptest_elf_start, _binary_user_maptest_elf_end);
+}
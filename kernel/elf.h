@@ -0,0 +1,45 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include "types.h"
+
+#define ELF_MAGIC 0x464C457F // "\x7fELF"
+#define ELF_CLASS32 1
+#define ELF_DATA_LSB 1
+#define ET_EXEC 2
+#define EM_386 3
+#define PT_LOAD 1
+#define PF_W 2
+
+typedef struct {
+    u8 ident[16];
+    u16 type;
+    u16 machine;
+    u32 version;
+    u32 entry;
+    u32 phoff;
+    u32 shoff;
+    u32 flags;
+    u16 ehsize;
+    u16 phentsize;
+    u16 phnum;
+    u16 shentsize;
+    u16 shnum;
+    u16 shstrndx;
+} __attribute__((packed)) elf_header_t;
+
+typedef struct {
+    u32 type;
+    u32 offset;
+    u32 vaddr;
+    u32 paddr;
+    u32 filesz;
+    u32 memsz;
+    u32 flags;
+    u32 align;
+} __attribute__((packed)) elf_phdr_t;
+
+int elf_exec(char* path);
+void elf_install_programs();
+
+#endif
@@ -1,34 +1,231 @@
 #include "fs.h"
+#include "search.h"
+#include "journal.h"
+#include "slab.h"
+#include "../libc/lz.h"
 #include "../libc/string.h"
 #include "../drivers/screen.h"
 
 File file_system[MAX_FILES];
 char cwd[MAX_FILENAME] = "/"; // Global Current Working Directory
+int fs_quiet = 0; // Suppress success messages (quiet boot)
+int fs_compress = 0; // Store new contents LZ-compressed ("compress on")
+u32 fs_cache_hits = 0;
+u32 fs_cache_misses = 0;
+
+void fs_message(char* message) {
+    if (!fs_quiet) kprint(message);
+}
 
 // Helper: Resolve full path (e.g., "file.txt" -> "/home/file.txt")
-void get_full_path(char* name, char* full_path) {
+// Returns 0 if the result would not fit in MAX_FILENAME.
+int get_full_path(char* name, char* full_path) {
+    int len = 0;
+    if (name[0] != '/') {
+        len = strlen(cwd);
+        if (len > 0 && cwd[len-1] != '/') len++;
+    }
+    if (len + strlen(name) >= MAX_FILENAME) {
+        kprint("Error: Path too long.\n");
+        return 0;
+    }
+
     if (name[0] == '/') {
         strcpy(full_path, name);
     } else {
         strcpy(full_path, cwd);
-        int len = strlen(full_path);
+        len = strlen(full_path);
         if (len > 0 && full_path[len-1] != '/') {
             strcat(full_path, "/");
         }
         strcat(full_path, name);
     }
+    return 1;
+}
+
+// --- Contents storage ---
+
+#define FS_CLASSES 7
+
+typedef struct {
+    u32 version; // Of the file decoded here, 0 if unused
+    u32 last_used;
+    char data[MAX_FILESIZE + 1];
+} fs_cache_entry_t;
+
+int fs_class_size[FS_CLASSES] = { 32, 64, 128, 256, 512, 768, MAX_FILESIZE + 1 };
+slab_cache_t fs_storage[FS_CLASSES];
+int fs_storage_ready = 0;
+u32 fs_next_version = 1;
+u32 fs_cache_clock = 0;
+fs_cache_entry_t fs_cache[FS_CACHE_ENTRIES];
+char fs_packed[MAX_FILESIZE];
+char fs_scratch[MAX_FILESIZE + 1];
+
+slab_cache_t* fs_storage_class(int bytes) {
+    int c = 0;
+    while (fs_class_size[c] < bytes) c++;
+    return &fs_storage[c];
+}
+
+void fs_free_data(File* f) {
+    if (f->data) slab_free(fs_storage_class(f->stored + 1), f->data);
+    f->data = 0;
+    f->stored = 0;
+    f->compressed = 0;
+    f->version = fs_next_version++;
+}
+
+// Replace f's contents with size bytes (at most MAX_FILESIZE). Returns 0,
+// leaving the old contents, if out of memory.
+int fs_store(File* f, char* data, int size) {
+    char* src = data;
+    int stored = size;
+    int compressed = 0;
+    if (fs_compress && size >= FS_COMPRESS_MIN) {
+        int n = lz_compress(data, size, fs_packed, size - 1);
+        if (n > 0) {
+            src = fs_packed;
+            stored = n;
+            compressed = 1;
+        }
+    }
+
+    char* buf = 0;
+    if (stored > 0) {
+        buf = (char*)slab_alloc(fs_storage_class(stored + 1));
+        if (!buf) {
+            kprint("Error: Out of memory.\n");
+            return 0;
+        }
+        memory_copy(src, buf, stored);
+        buf[stored] = '\0'; // Raw contents read as a string
+    }
+    fs_free_data(f);
+    f->data = buf;
+    f->stored = stored;
+    f->compressed = compressed;
+    f->size = size;
+    return 1;
+}
+
+// Decode f's contents into buf (MAX_FILESIZE + 1 bytes) and terminate
+// them. Returns how many bytes f actually holds.
+int fs_load(File* f, char* buf) {
+    int n = f->stored;
+    if (f->compressed) n = lz_decompress(f->data, f->stored, buf, MAX_FILESIZE);
+    else if (n > 0) memory_copy(f->data, buf, n);
+    if (n < 0) {
+        kprint("Error: Corrupt file contents.\n");
+        n = 0;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+// f's raw contents, zero terminated. Compressed files are decoded into
+// the least recently used cache entry, so the pointer is only good until
+// FS_CACHE_ENTRIES other compressed files have been read.
+char* fs_data(File* f) {
+    if (!f->data) return "";
+    if (!f->compressed) return f->data;
+
+    fs_cache_entry_t* victim = &fs_cache[0];
+    for (int i = 0; i < FS_CACHE_ENTRIES; i++) {
+        fs_cache_entry_t* e = &fs_cache[i];
+        if (e->version == f->version) {
+            fs_cache_hits++;
+            e->last_used = ++fs_cache_clock;
+            return e->data;
+        }
+        if (e->last_used < victim->last_used) victim = e;
+    }
+    fs_cache_misses++;
+    fs_load(f, victim->data);
+    victim->version = f->version;
+    victim->last_used = ++fs_cache_clock;
+    return victim->data;
+}
+
+// How many bytes can be read at fs_data(f). That is f->size, except that
+// a size not yet checked by fs_check() may exceed what is stored, and a
+// deleted file holds nothing.
+int fs_data_size(File* f) {
+    if (!f->compressed) return f->stored;
+    return f->size < 0 ? 0 : f->size > MAX_FILESIZE ? MAX_FILESIZE : f->size;
+}
+
+// Contents cut or zero-padded to size
+int fs_resize(File* f, int size) {
+    int n = fs_load(f, fs_scratch);
+    if (n < size) memory_set((u8*)fs_scratch + n, 0, size - n);
+    return fs_store(f, fs_scratch, size);
+}
+
+// Turn compression on or off, re-storing every file to match
+void fs_set_compress(int on) {
+    fs_compress = on;
+    for (int i = 0; i < MAX_FILES; i++) {
+        File* f = &file_system[i];
+        if (f->used && f->type == FS_FILE) fs_resize(f, f->size);
+    }
 }
 
 void init_fs() {
-    for (int i = 0; i < MAX_FILES; i++) file_system[i].used = 0;
-    fs_create("readme.txt");
-    fs_write("readme.txt", "Welcome! Root directory.");
-    kprint("[FS] File System Initialized.\n");
+    if (!fs_storage_ready) {
+        for (int c = 0; c < FS_CLASSES; c++) slab_init(&fs_storage[c], "fs_data", fs_class_size[c]);
+        fs_storage_ready = 1;
+    }
+    for (int i = 0; i < MAX_FILES; i++) {
+        fs_free_data(&file_system[i]);
+        file_system[i].used = 0;
+        file_system[i].generation++;
+    }
+    index_enable(index_enabled); // Empty again
+    fs_message("[FS] File System Initialized.\n");
+}
+
+// Default files. Not needed to reach the prompt, so the kernel runs this
+// after the prompt is up.
+void fs_populate() {
+    if (fs_find("/readme.txt")) return; // Kept on disk from an earlier boot
+    fs_create("/readme.txt");
+    fs_write("/readme.txt", "Welcome! Root directory.");
+}
+
+// Look up a file or directory without printing anything. Returns 0 if
+// there is no such entry.
+File* fs_find(char* name) {
+    char full_path[MAX_FILENAME];
+    int saved = fs_quiet;
+    fs_quiet = 1;
+    int ok = get_full_path(name, full_path);
+    fs_quiet = saved;
+    if (!ok) return 0;
+
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (file_system[i].used && strcmp(file_system[i].name, full_path) == 0) {
+            return &file_system[i];
+        }
+    }
+    return 0;
+}
+
+// A slot for a new file, or -1 if all are taken. Slots freed since the
+// last commit are only used after committing (see journal_slot_free).
+int fs_free_slot() {
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!file_system[i].used && journal_slot_free(i)) return i;
+    }
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!file_system[i].used) return journal_commit() ? i : -1;
+    }
+    return -1;
 }
 
 int fs_create_entry(char* name, int type) {
     char full_path[MAX_FILENAME];
-    get_full_path(name, full_path);
+    if (!get_full_path(name, full_path)) return 0;
 
     for (int i = 0; i < MAX_FILES; i++) {
         if (file_system[i].used && strcmp(file_system[i].name, full_path) == 0) {
@@ -36,18 +233,20 @@ int fs_create_entry(char* name, int type) {
             return 0;
         }
     }
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (file_system[i].used == 0) {
-            file_system[i].used = 1;
-            strcpy(file_system[i].name, full_path);
-            file_system[i].size = 0;
-            file_system[i].type = type;
-            kprint(type == FS_DIR ? "Directory created.\n" : "File created.\n");
-            return 1;
-        }
+    int i = fs_free_slot();
+    if (i < 0) {
+        kprint("Error: Disk full.\n");
+        return 0;
     }
-    kprint("Error: Disk full.\n");
-    return 0;
+    file_system[i].used = 1;
+    file_system[i].generation++;
+    strcpy(file_system[i].name, full_path);
+    fs_free_data(&file_system[i]);
+    file_system[i].size = 0;
+    file_system[i].type = type;
+    journal_file_changed(i, 0);
+    fs_message(type == FS_DIR ? "Directory created.\n" : "File created.\n");
+    return 1;
 }
 
 int fs_create(char* name) { return fs_create_entry(name, FS_FILE); }
@@ -84,7 +283,12 @@ int fs_cd(char* path) {
     }
 
     char full_path[MAX_FILENAME];
-    get_full_path(path, full_path);
+    if (!get_full_path(path, full_path)) return 0;
+    // Leave room for the trailing slash added below
+    if (strlen(full_path) >= MAX_FILENAME - 1) {
+        kprint("Error: Path too long.\n");
+        return 0;
+    }
 
     // 3. Verify Directory Exists
     for (int i = 0; i < MAX_FILES; i++) {
@@ -104,6 +308,20 @@ void fs_pwd() {
     kprint("\n");
 }
 
+// "  24 B", or "  1024 B (312 B compressed)"
+void fs_list_size(File* f) {
+    char num[12];
+    kprint("  ");
+    int_to_ascii(f->size, num);
+    kprint(num);
+    kprint(" B");
+    if (!f->compressed) return;
+    kprint(" (");
+    int_to_ascii(f->stored, num);
+    kprint(num);
+    kprint(" B compressed)");
+}
+
 void fs_list() {
     kprint("Listing: "); kprint(cwd); kprint("\n");
     int found = 0;
@@ -124,6 +342,7 @@ void fs_list() {
                     kprint("[DIR] "); kprint(relative);
                 } else {
                     kprint("      "); kprint(relative);
+                    fs_list_size(&file_system[i]);
                 }
                 kprint("\n");
                 found = 1;
@@ -133,9 +352,19 @@ void fs_list() {
     if (!found) kprint("(Empty)\n");
 }
 
+// Replace f's contents, keeping the search index and the disk up to date
+int fs_write_file(File* f, char* data, int size) {
+    int slot = f - file_system;
+    index_file_removed(slot);
+    int ok = fs_store(f, data, size);
+    index_file_added(slot);
+    if (ok) journal_file_changed(slot, 1);
+    return ok;
+}
+
 int fs_write(char* name, char* data) {
     char full_path[MAX_FILENAME];
-    get_full_path(name, full_path);
+    if (!get_full_path(name, full_path)) return 0;
 
     for (int i = 0; i < MAX_FILES; i++) {
         if (file_system[i].used && strcmp(file_system[i].name, full_path) == 0) {
@@ -143,9 +372,11 @@ int fs_write(char* name, char* data) {
                 kprint("Error: Cannot write to directory.\n");
                 return 0;
             }
-            strcpy(file_system[i].data, data);
-            file_system[i].size = strlen(data);
-            kprint("Written.\n");
+            // Payloads longer than the file slot are truncated
+            int size = strlen(data);
+            if (size > MAX_FILESIZE - 1) size = MAX_FILESIZE - 1;
+            if (!fs_write_file(&file_system[i], data, size)) return 0;
+            fs_message("Written.\n");
             return 1;
         }
     }
@@ -153,14 +384,31 @@ int fs_write(char* name, char* data) {
     return 0;
 }
 
+// Binary-safe write of size bytes (fs_write stops at the first zero).
+// Fails instead of truncating, since a cut-off binary is useless.
+int fs_write_data(char* name, char* data, int size) {
+    File* f = fs_find(name);
+    if (!f || f->type == FS_DIR) {
+        kprint("Error: File not found.\n");
+        return 0;
+    }
+    if (size < 0 || size > MAX_FILESIZE) {
+        kprint("Error: File too large.\n");
+        return 0;
+    }
+    if (!fs_write_file(f, data, size)) return 0;
+    fs_message("Written.\n");
+    return 1;
+}
+
 void fs_read(char* name) {
     char full_path[MAX_FILENAME];
-    get_full_path(name, full_path);
+    if (!get_full_path(name, full_path)) return;
 
     for (int i = 0; i < MAX_FILES; i++) {
         if (file_system[i].used && strcmp(file_system[i].name, full_path) == 0) {
             if (file_system[i].type == FS_DIR) kprint("Error: Is a directory.\n");
-            else { kprint(file_system[i].data); kprint("\n"); }
+            else { kprint(fs_data(&file_system[i])); kprint("\n"); }
             return;
         }
     }
@@ -169,11 +417,15 @@ void fs_read(char* name) {
 
 void fs_delete(char* name) {
     char full_path[MAX_FILENAME];
-    get_full_path(name, full_path);
+    if (!get_full_path(name, full_path)) return;
     for (int i = 0; i < MAX_FILES; i++) {
         if (file_system[i].used && strcmp(file_system[i].name, full_path) == 0) {
+            index_file_removed(i);
             file_system[i].used = 0;
-            kprint("Deleted.\n");
+            file_system[i].generation++;
+            fs_free_data(&file_system[i]);
+            journal_file_changed(i, 0);
+            fs_message("Deleted.\n");
             return;
         }
     }
@@ -181,8 +433,8 @@ void fs_delete(char* name) {
 }
 
 void fs_copy(char* src, char* dest) {
-    char full_src[MAX_FILENAME]; get_full_path(src, full_src);
-    char full_dest[MAX_FILENAME]; get_full_path(dest, full_dest);
+    char full_src[MAX_FILENAME]; if (!get_full_path(src, full_src)) return;
+    char full_dest[MAX_FILENAME]; if (!get_full_path(dest, full_dest)) return;
 
     int src_idx = -1;
     for (int i = 0; i < MAX_FILES; i++) {
@@ -192,30 +444,94 @@ void fs_copy(char* src, char* dest) {
     }
     if (src_idx == -1) { kprint("Error: Source not found.\n"); return; }
 
-    int dest_idx = -1;
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (!file_system[i].used) { dest_idx = i; break; }
-    }
+    int dest_idx = fs_free_slot();
     if (dest_idx == -1) { kprint("Error: Disk full.\n"); return; }
 
+    File* from = &file_system[src_idx];
+    if (!fs_store(&file_system[dest_idx], fs_data(from), fs_data_size(from))) return;
     file_system[dest_idx].used = 1;
+    file_system[dest_idx].generation++;
     strcpy(file_system[dest_idx].name, full_dest);
-    file_system[dest_idx].type = file_system[src_idx].type;
-    file_system[dest_idx].size = file_system[src_idx].size;
-    strcpy(file_system[dest_idx].data, file_system[src_idx].data);
-    kprint("Copied.\n");
+    file_system[dest_idx].type = from->type;
+    index_file_added(dest_idx);
+    journal_file_changed(dest_idx, 1);
+    fs_message("Copied.\n");
 }
 
 void fs_rename(char* src, char* dest) {
-    char full_src[MAX_FILENAME]; get_full_path(src, full_src);
-    char full_dest[MAX_FILENAME]; get_full_path(dest, full_dest);
+    char full_src[MAX_FILENAME]; if (!get_full_path(src, full_src)) return;
+    char full_dest[MAX_FILENAME]; if (!get_full_path(dest, full_dest)) return;
 
     for (int i = 0; i < MAX_FILES; i++) {
         if (file_system[i].used && strcmp(file_system[i].name, full_src) == 0) {
             strcpy(file_system[i].name, full_dest);
-            kprint("Renamed.\n");
+            journal_file_changed(i, 0);
+            fs_message("Renamed.\n");
             return;
         }
     }
     kprint("Error: Source not found.\n");
-}
\ No newline at end of file
+}
+
+void fs_check_error(char* what, int slot) {
+    char num[12];
+    int_to_ascii(slot, num);
+    kprint("Error: Slot ");
+    kprint(num);
+    kprint(": ");
+    kprint(what);
+    kprint("\n");
+}
+
+int fs_name_ok(File* f) {
+    int len = 0;
+    while (len < MAX_FILENAME && f->name[len]) len++;
+    return len < MAX_FILENAME && f->name[0] == '/';
+}
+
+// Consistency check of the file table (the "fsck" command, and
+// tools/host/fsck.c for disk images). With repair, bad entries are fixed
+// or dropped. Returns the number of problems found.
+int fs_check(int repair) {
+    int problems = 0;
+    for (int i = 0; i < MAX_FILES; i++) {
+        File* f = &file_system[i];
+        if (!f->used) continue;
+
+        int drop = 0;
+        if (!fs_name_ok(f)) {
+            fs_check_error("bad name", i);
+            drop = 1;
+        } else if (f->type != FS_FILE && f->type != FS_DIR) {
+            fs_check_error("bad type", i);
+            drop = 1;
+        } else {
+            for (int j = 0; j < i; j++) {
+                File* other = &file_system[j];
+                if (other->used && fs_name_ok(other) && strcmp(other->name, f->name) == 0) {
+                    fs_check_error("duplicate name", i);
+                    drop = 1;
+                    break;
+                }
+            }
+        }
+        int bad_size = !drop && (f->size < 0 || f->size > MAX_FILESIZE || (f->type == FS_DIR && f->size != 0));
+        if (bad_size) fs_check_error("bad size", i);
+        if (!drop && !bad_size) continue;
+
+        problems++;
+        if (!repair) continue;
+        if (drop) {
+            f->used = 0;
+            f->generation++;
+            fs_free_data(f);
+        } else if (f->type == FS_DIR || f->size < 0) {
+            fs_resize(f, 0);
+        } else if (!fs_resize(f, MAX_FILESIZE)) {
+            fs_resize(f, 0);
+        }
+        journal_file_changed(i, 0);
+    }
+    if (repair) index_enable(index_enabled);
+    return problems;
+}
@@ -3,7 +3,9 @@
 
 #include "types.h"
 
-#define MAX_FILES 20       
+#ifndef MAX_FILES
+#define MAX_FILES 20       // Overridable, e.g. -DMAX_FILES=10240 for host-bench
+#endif
 #define MAX_FILENAME 32    
 #define MAX_FILESIZE 1024
 
@@ -11,27 +13,54 @@
 #define FS_FILE 0
 #define FS_DIR  1
 
+#define FS_COMPRESS_MIN 64  // Smaller files are always stored raw
+#define FS_CACHE_ENTRIES 4  // Decompressed files kept for reading
+
+// Contents live in slab storage sized to fit, LZ-compressed while
+// compression is on (and it saves space). Read them with fs_data().
 typedef struct {
     char name[MAX_FILENAME];
-    char data[MAX_FILESIZE];
-    int size;
+    char* data;     // Stored bytes, 0 when empty
+    int size;       // Raw size
+    int stored;     // Bytes at data
+    int compressed;
+    u32 version;    // New on every change, keys the decompressed cache
+    u32 generation; // New each time the slot gets another file (create, delete)
     int used;
     int type; 
 } File;
 
+extern File file_system[MAX_FILES];
+extern int fs_compress;
+extern u32 fs_cache_hits;
+extern u32 fs_cache_misses;
+
 // --- EXPOSE CWD GLOBALLY ---
 extern char cwd[MAX_FILENAME]; 
+extern int fs_quiet;
 
 void init_fs();
+void fs_message(char* message);
+File* fs_find(char* name);
+int get_full_path(char* name, char* full_path);
+void fs_populate();
 void fs_list();
 int fs_create(char* name);
 int fs_mkdir(char* name);      
 int fs_cd(char* path);         
 void fs_pwd();                 
 int fs_write(char* name, char* data);
+int fs_write_data(char* name, char* data, int size);
+int fs_write_file(File* f, char* data, int size);
 void fs_read(char* name);
 void fs_delete(char* name);
 void fs_copy(char* src, char* dest);
 void fs_rename(char* src, char* dest);
+int fs_check(int repair);
+char* fs_data(File* f);
+int fs_data_size(File* f);
+int fs_load(File* f, char* buf);
+int fs_store(File* f, char* data, int size);
+void fs_set_compress(int on);
 
 #endif
\ No newline at end of file
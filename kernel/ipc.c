@@ -0,0 +1,196 @@
+#include "ipc.h"
+#include "sched.h"
+#include "slab.h"
+#include "mem.h"
+#include "../libc/string.h"
+
+// Pipes and message queues between kernel threads. Blocking goes through
+// the scheduler: a thread that has to wait records its PID in the object
+// and calls block_current(); the other side wake()s it.
+
+slab_cache_t pipe_cache;
+
+void init_ipc() {
+    slab_init(&pipe_cache, "pipe", sizeof(pipe_t));
+}
+
+void wake_waiter(int* pid) {
+    if (*pid) {
+        wake(*pid);
+        *pid = 0;
+    }
+}
+
+// --- Pipes ---
+
+// One reader and one writer to start with. Returns 0 when out of memory.
+pipe_t* pipe_create() {
+    pipe_t* pipe = (pipe_t*)slab_alloc(&pipe_cache);
+    if (!pipe) return 0;
+    pipe->buffer = (char*)page_alloc();
+    if (!pipe->buffer) {
+        slab_free(&pipe_cache, pipe);
+        return 0;
+    }
+    pipe->read_pos = 0;
+    pipe->write_pos = 0;
+    pipe->readers = 1;
+    pipe->writers = 1;
+    pipe->waiting_reader = 0;
+    pipe->waiting_writer = 0;
+    return pipe;
+}
+
+void pipe_destroy_if_unused(pipe_t* pipe) {
+    if (pipe->readers == 0 && pipe->writers == 0) {
+        page_free(pipe->buffer);
+        slab_free(&pipe_cache, pipe);
+    }
+}
+
+// Blocks while the pipe is full. Returns the bytes written, or -1 if
+// there is no reader left (or nobody could ever drain the pipe).
+int pipe_write(pipe_t* pipe, char* data, int len) {
+    int written = 0;
+    while (written < len) {
+        if (pipe->readers == 0) return -1;
+
+        u32 space = PIPE_SIZE - (pipe->write_pos - pipe->read_pos);
+        if (space == 0) {
+            pipe->waiting_writer = current->pid;
+            if (!block_current()) return written ? written : -1;
+            continue;
+        }
+
+        u32 n = len - written;
+        if (n > space) n = space;
+        // At most two pieces: up to the end of the ring, then from its start
+        while (n > 0) {
+            u32 index = pipe->write_pos % PIPE_SIZE;
+            u32 chunk = PIPE_SIZE - index;
+            if (chunk > n) chunk = n;
+            memory_copy(data + written, pipe->buffer + index, chunk);
+            pipe->write_pos += chunk;
+            written += chunk;
+            n -= chunk;
+        }
+        wake_waiter(&pipe->waiting_reader);
+    }
+    return written;
+}
+
+// Blocks while the pipe is empty. Returns the bytes read, 0 at end of
+// file (no writers left), or -1 if nobody could ever fill the pipe.
+int pipe_read(pipe_t* pipe, char* buf, int len) {
+    while (pipe->write_pos == pipe->read_pos) {
+        if (pipe->writers == 0) return 0;
+        pipe->waiting_reader = current->pid;
+        if (!block_current()) return -1;
+    }
+
+    u32 n = pipe->write_pos - pipe->read_pos;
+    if (n > (u32)len) n = len;
+    int done = 0;
+    while (n > 0) {
+        u32 index = pipe->read_pos % PIPE_SIZE;
+        u32 chunk = PIPE_SIZE - index;
+        if (chunk > n) chunk = n;
+        memory_copy(pipe->buffer + index, buf + done, chunk);
+        pipe->read_pos += chunk;
+        done += chunk;
+        n -= chunk;
+    }
+    wake_waiter(&pipe->waiting_writer);
+    return done;
+}
+
+void pipe_close_reader(pipe_t* pipe) {
+    pipe->readers--;
+    wake_waiter(&pipe->waiting_writer); // It will see the broken pipe
+    pipe_destroy_if_unused(pipe);
+}
+
+void pipe_close_writer(pipe_t* pipe) {
+    pipe->writers--;
+    wake_waiter(&pipe->waiting_reader); // It will see end of file
+    pipe_destroy_if_unused(pipe);
+}
+
+// --- Message queues ---
+
+mqueue_t* mq_create() {
+    mqueue_t* q = (mqueue_t*)page_alloc();
+    if (!q) return 0;
+    q->head = 0;
+    q->tail = 0;
+    q->waiting_receiver = 0;
+    q->waiting_sender = 0;
+    return q;
+}
+
+void mq_destroy(mqueue_t* q) {
+    // Pages still in flight belong to nobody
+    for (u32 i = q->head; i != q->tail; i++) {
+        message_t* m = &q->slots[i % MQ_SLOTS];
+        if (m->page) page_free(m->page);
+    }
+    page_free(q);
+}
+
+// Wait for a free slot. Returns 0 if nobody could ever free one.
+int mq_wait_slot(mqueue_t* q) {
+    while (q->tail - q->head == MQ_SLOTS) {
+        q->waiting_sender = current->pid;
+        if (!block_current()) return 0;
+    }
+    return 1;
+}
+
+// Copy a small message (at most MSG_INLINE bytes) into the queue
+int mq_send(mqueue_t* q, char* data, u32 len) {
+    if (len > MSG_INLINE || !mq_wait_slot(q)) return -1;
+    message_t* m = &q->slots[q->tail % MQ_SLOTS];
+    m->len = len;
+    m->page = 0;
+    m->sender = current->pid;
+    memory_copy(data, m->data, len);
+    q->tail++;
+    wake_waiter(&q->waiting_receiver);
+    return 0;
+}
+
+// Hand one of our pages (len bytes used) to the receiver without copying
+int mq_send_page(mqueue_t* q, void* page, u32 len) {
+    if (len > PAGE_SIZE || !mq_wait_slot(q)) return -1;
+    if (!proc_disown_page(current, page)) return -1; // Not ours to give
+    message_t* m = &q->slots[q->tail % MQ_SLOTS];
+    m->len = len;
+    m->page = page;
+    m->sender = current->pid;
+    q->tail++;
+    wake_waiter(&q->waiting_receiver);
+    return 0;
+}
+
+// Blocks until a message arrives. A page that comes with it is now
+// charged to (and must eventually be freed by) the receiver. Returns -1,
+// leaving the message queued, if the receiver cannot take the page (it is
+// at its memory limit).
+int mq_receive(mqueue_t* q, message_t* msg) {
+    while (q->tail == q->head) {
+        q->waiting_receiver = current->pid;
+        if (!block_current()) return -1;
+    }
+    message_t* m = &q->slots[q->head % MQ_SLOTS];
+    if (m->page && (current->pages >= current->mem_limit || !proc_own_page(current, m->page))) {
+        current->failed_allocs++;
+        return -1;
+    }
+    msg->len = m->len;
+    msg->page = m->page;
+    msg->sender = m->sender;
+    if (!m->page) memory_copy(m->data, msg->data, m->len);
+    q->head++;
+    wake_waiter(&q->waiting_sender);
+    return 0;
+}
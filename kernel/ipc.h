@@ -0,0 +1,56 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include "types.h"
+
+void init_ipc();
+
+// --- Pipes: byte streams through a one-page ring buffer ---
+
+#define PIPE_SIZE 4096 // One page
+
+typedef struct {
+    char* buffer;
+    u32 read_pos;        // Bytes read / written so far; the ring index
+    u32 write_pos;       // is pos % PIPE_SIZE
+    int readers;
+    int writers;
+    int waiting_reader;  // PID blocked on this pipe, or 0
+    int waiting_writer;
+} pipe_t;
+
+pipe_t* pipe_create();
+int pipe_write(pipe_t* pipe, char* data, int len);
+int pipe_read(pipe_t* pipe, char* buf, int len);
+void pipe_close_reader(pipe_t* pipe);
+void pipe_close_writer(pipe_t* pipe);
+
+// --- Message queues: fixed-size slots ---
+
+#define MQ_SLOTS 32
+#define MSG_INLINE 52 // Payload bytes copied into the slot
+
+// Small messages are copied inline. Large ones are a whole page whose
+// ownership moves from sender to receiver, so the data is never copied.
+typedef struct {
+    u32 len;
+    void* page;
+    char data[MSG_INLINE];
+    int sender;
+} message_t;
+
+typedef struct {
+    message_t slots[MQ_SLOTS];
+    u32 head;            // Messages received / sent so far
+    u32 tail;
+    int waiting_receiver;
+    int waiting_sender;
+} mqueue_t;
+
+mqueue_t* mq_create();
+void mq_destroy(mqueue_t* q);
+int mq_send(mqueue_t* q, char* data, u32 len);
+int mq_send_page(mqueue_t* q, void* page, u32 len);
+int mq_receive(mqueue_t* q, message_t* msg);
+
+#endif
@@ -0,0 +1,306 @@
+#include "journal.h"
+#include "search.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+// Keeps the file table (file_system[]) on a disk. fs.c changes the table
+// in memory and calls journal_file_changed(); the changed table sectors
+// go to the journal together, once per journal_group operations (group
+// commit) or when journal_commit() is called.
+
+blockdev_t* journal_dev = 0;
+int journal_group = JOURNAL_GROUP;
+u32 journal_commits = 0;
+u32 journal_flushes = 0;
+
+superblock_t super;
+u32 journal_seq = 0;  // Of the next transaction
+u32 journal_head = 0; // Next free journal sector
+int group_ops = 0;    // Operations since the last commit
+int dirty_count = 0;
+u8 dirty[TABLE_SECTORS];  // Changed since the last commit
+u8 logged[TABLE_SECTORS]; // Committed to the journal, not yet checkpointed
+u8 table_copy[TABLE_SECTORS][SECTOR_SIZE]; // The table as last committed
+u8 txn_buf[(JOURNAL_TXN_BLOCKS + 2) * SECTOR_SIZE];
+u8 sector_buf[SECTOR_SIZE];
+char data_buf[DATA_SECTORS_PER_FILE * SECTOR_SIZE + 1]; // Raw file contents
+
+u32 journal_checksum(u8* data, int len) {
+    u32 sum = 2166136261u; // FNV-1a
+    for (int i = 0; i < len; i++) sum = (sum ^ data[i]) * 16777619u;
+    return sum;
+}
+
+// Table sector s as it is in memory now
+void table_image(int s, u8* buf) {
+    memory_set(buf, 0, SECTOR_SIZE);
+    fs_record_t* r = (fs_record_t*)buf;
+    for (int i = 0; i < RECORDS_PER_SECTOR; i++) {
+        int slot = s * RECORDS_PER_SECTOR + i;
+        if (slot >= MAX_FILES || !file_system[slot].used) continue;
+        memory_copy(file_system[slot].name, r[i].name, MAX_FILENAME);
+        r[i].size = file_system[slot].size;
+        r[i].used = 1;
+        r[i].type = file_system[slot].type;
+    }
+}
+
+int disk_write(u32 lba, u32 count, void* buf) {
+    if (journal_dev->write(lba, count, buf)) return 1;
+    kprint("Error: Disk write failed.\n");
+    return 0;
+}
+
+// Contents of slot as they go on the disk: raw, zero-padded
+int write_file_data(int slot) {
+    memory_set((u8*)data_buf, 0, sizeof(data_buf));
+    fs_load(&file_system[slot], data_buf);
+    return disk_write(DATA_START + slot * DATA_SECTORS_PER_FILE, DATA_SECTORS_PER_FILE, data_buf);
+}
+
+int disk_flush() {
+    journal_flushes++;
+    if (journal_dev->flush()) return 1;
+    kprint("Error: Disk flush failed.\n");
+    return 0;
+}
+
+int write_super() {
+    memory_set(sector_buf, 0, SECTOR_SIZE);
+    memory_copy((char*)&super, (char*)sector_buf, sizeof(super));
+    return disk_write(0, 1, sector_buf) && disk_flush();
+}
+
+// Write every committed table sector home and empty the journal. Until
+// the superblock is updated, a crash just replays the same transactions.
+int journal_checkpoint() {
+    for (int s = 0; s < TABLE_SECTORS; s++) {
+        if (!logged[s]) continue;
+        if (!disk_write(TABLE_START + s, 1, table_copy[s])) return 0;
+        logged[s] = 0;
+    }
+    if (!disk_flush()) return 0;
+    super.seq = journal_seq;
+    if (!write_super()) return 0;
+    journal_head = 0;
+    return 1;
+}
+
+// Write the changes since the last commit as one transaction. Returns 0
+// if the disk failed (the changes stay in memory and are retried).
+int journal_commit() {
+    group_ops = 0;
+    if (!journal_dev || dirty_count == 0) return 1;
+    // There is always room (see below) unless a checkpoint failed
+    if (journal_head + dirty_count + 2 > JOURNAL_SECTORS && !journal_checkpoint()) return 0;
+
+    memory_set(txn_buf, 0, SECTOR_SIZE);
+    journal_desc_t* desc = (journal_desc_t*)txn_buf;
+    desc->magic = JOURNAL_DESC;
+    desc->seq = journal_seq;
+    for (int s = 0; s < TABLE_SECTORS; s++) {
+        if (!dirty[s]) continue;
+        table_image(s, txn_buf + (1 + desc->count) * SECTOR_SIZE);
+        desc->lba[desc->count++] = TABLE_START + s;
+    }
+    u32 count = desc->count;
+    u8* commit_sector = txn_buf + (1 + count) * SECTOR_SIZE;
+    memory_set(commit_sector, 0, SECTOR_SIZE);
+    journal_commit_t* commit = (journal_commit_t*)commit_sector;
+    commit->magic = JOURNAL_COMMIT;
+    commit->seq = journal_seq;
+    commit->checksum = journal_checksum(txn_buf, (1 + count) * SECTOR_SIZE);
+
+    // Blocks (and file data written since the last commit) must be on
+    // the disk before the commit sector that makes them count
+    u32 lba = JOURNAL_START + journal_head;
+    if (!disk_write(lba, 1 + count, txn_buf) || !disk_flush()) return 0;
+    if (!disk_write(lba + 1 + count, 1, commit_sector) || !disk_flush()) return 0;
+
+    for (u32 i = 0; i < count; i++) {
+        int s = desc->lba[i] - TABLE_START;
+        memory_copy((char*)txn_buf + (1 + i) * SECTOR_SIZE, (char*)table_copy[s], SECTOR_SIZE);
+        logged[s] = 1;
+        dirty[s] = 0;
+    }
+    dirty_count = 0;
+    journal_head += count + 2;
+    journal_seq++;
+    journal_commits++;
+
+    // Always leave room for the largest transaction
+    if (JOURNAL_SECTORS - journal_head < JOURNAL_TXN_BLOCKS + 2) return journal_checkpoint();
+    return 1;
+}
+
+// The last committed table has slot free too. Contents are written in
+// place before the table commits, so writing into a slot that the disk
+// still gives to a deleted file would hand that file the new contents
+// after a crash.
+int journal_slot_free(int slot) {
+    if (!journal_dev) return 1;
+    fs_record_t* r = (fs_record_t*)table_copy[slot / RECORDS_PER_SECTOR] + slot % RECORDS_PER_SECTOR;
+    return !r->used;
+}
+
+// Called by fs.c after it changed file_system[slot] (and its contents, if
+// with_data)
+void journal_file_changed(int slot, int with_data) {
+    if (!journal_dev) return;
+    int s = slot / RECORDS_PER_SECTOR;
+    if (!dirty[s]) {
+        if (dirty_count == JOURNAL_TXN_BLOCKS) journal_commit();
+        dirty[s] = 1;
+        dirty_count++;
+    }
+    if (with_data) write_file_data(slot);
+    if (++group_ops >= journal_group) journal_commit();
+}
+
+// Apply every complete transaction from super.seq on. Returns how many.
+int journal_replay() {
+    u32 pos = 0;
+    u32 seq = super.seq;
+    int replayed = 0;
+    journal_desc_t* desc = (journal_desc_t*)txn_buf;
+
+    while (pos + 2 <= JOURNAL_SECTORS) {
+        if (!journal_dev->read(JOURNAL_START + pos, 1, txn_buf)) break;
+        u32 count = desc->count;
+        if (desc->magic != JOURNAL_DESC || desc->seq != seq) break;
+        if (count == 0 || count > JOURNAL_TXN_BLOCKS || pos + count + 2 > JOURNAL_SECTORS) break;
+        if (!journal_dev->read(JOURNAL_START + pos + 1, count + 1, txn_buf + SECTOR_SIZE)) break;
+
+        // A crash before the commit sector reached the disk leaves an old
+        // one (wrong seq) or a mismatching checksum
+        journal_commit_t* commit = (journal_commit_t*)(txn_buf + (1 + count) * SECTOR_SIZE);
+        if (commit->magic != JOURNAL_COMMIT || commit->seq != seq) break;
+        if (commit->checksum != journal_checksum(txn_buf, (1 + count) * SECTOR_SIZE)) break;
+
+        int ok = 1;
+        for (u32 i = 0; i < count; i++) {
+            if (desc->lba[i] < TABLE_START || desc->lba[i] >= DATA_START) ok = 0;
+        }
+        if (!ok) break;
+        for (u32 i = 0; i < count; i++) {
+            if (!disk_write(desc->lba[i], 1, txn_buf + (1 + i) * SECTOR_SIZE)) return -1;
+        }
+        pos += count + 2;
+        seq++;
+        replayed++;
+    }
+
+    journal_seq = seq;
+    journal_head = 0;
+    if (replayed) {
+        if (!disk_flush()) return -1;
+        super.seq = seq;
+        if (!write_super()) return -1;
+    }
+    return replayed;
+}
+
+// A read failed halfway through loading: back to an empty, RAM-only file
+// system rather than keep some other slot's contents as this file's
+void journal_mount_failed() {
+    kprint("Error: Disk read failed.\n");
+    journal_dev = 0;
+    for (int slot = 0; slot < MAX_FILES; slot++) {
+        fs_store(&file_system[slot], "", 0);
+        file_system[slot].used = 0;
+        file_system[slot].generation++;
+    }
+    index_enable(index_enabled);
+}
+
+// Load the file system from dev, replaying the journal first. Returns the
+// number of transactions replayed, -1 if dev holds no file system and -2
+// if it holds one that cannot be used or could not be read.
+int journal_mount(blockdev_t* dev) {
+    if (dev->sectors < FS_DISK_SECTORS) return -1;
+    if (!dev->read(0, 1, sector_buf)) {
+        kprint("Error: Disk read failed.\n"); // Not a reason to format it
+        return -2;
+    }
+    memory_copy((char*)sector_buf, (char*)&super, sizeof(super));
+    if (super.magic != FS_MAGIC || super.version != FS_VERSION) return -1;
+    if (super.max_files != MAX_FILES || super.journal_sectors != JOURNAL_SECTORS) {
+        kprint("Error: Disk has a different file system layout.\n");
+        return -2;
+    }
+
+    journal_dev = dev;
+    int replayed = journal_replay();
+    if (replayed < 0 || !dev->read(TABLE_START, TABLE_SECTORS, table_copy)) {
+        kprint("Error: Disk read failed.\n");
+        journal_dev = 0;
+        return -2;
+    }
+
+    for (int slot = 0; slot < MAX_FILES; slot++) {
+        File* f = &file_system[slot];
+        fs_record_t* r = (fs_record_t*)table_copy[slot / RECORDS_PER_SECTOR] + slot % RECORDS_PER_SECTOR;
+        fs_store(f, "", 0);
+        f->used = r->used != 0;
+        f->generation++; // Whatever was in the slot is gone
+        if (!f->used) continue;
+        memory_copy(r->name, f->name, MAX_FILENAME);
+        f->type = r->type;
+        if (f->type == FS_FILE) {
+            // A bad size is kept for fs_check() to find, but never read past
+            int n = r->size < 0 ? 0 : r->size > MAX_FILESIZE ? MAX_FILESIZE : r->size;
+            if (!dev->read(DATA_START + slot * DATA_SECTORS_PER_FILE, DATA_SECTORS_PER_FILE, data_buf)) {
+                journal_mount_failed();
+                return -2;
+            }
+            if (!fs_store(f, data_buf, n)) continue;
+        }
+        f->size = r->size;
+    }
+    memory_set(dirty, 0, sizeof(dirty));
+    memory_set(logged, 0, sizeof(logged));
+    dirty_count = 0;
+    group_ops = 0;
+    index_enable(index_enabled); // Contents changed behind fs.c's back
+    return replayed;
+}
+
+// Put the current file system on dev, replacing whatever is there
+int journal_format(blockdev_t* dev) {
+    if (dev->sectors < FS_DISK_SECTORS) {
+        kprint("Error: Disk too small for the file system.\n");
+        return 0;
+    }
+    journal_dev = dev;
+    memory_set(sector_buf, 0, SECTOR_SIZE);
+    int ok = disk_write(JOURNAL_START, 1, sector_buf); // No stale transaction
+    for (int s = 0; ok && s < TABLE_SECTORS; s++) {
+        table_image(s, table_copy[s]);
+        ok = disk_write(TABLE_START + s, 1, table_copy[s]);
+    }
+    for (int slot = 0; ok && slot < MAX_FILES; slot++) {
+        if (file_system[slot].used && file_system[slot].type == FS_FILE) ok = write_file_data(slot);
+    }
+    super.magic = FS_MAGIC;
+    super.version = FS_VERSION;
+    super.max_files = MAX_FILES;
+    super.journal_sectors = JOURNAL_SECTORS;
+    super.seq = 1;
+    if (!ok || !disk_flush() || !write_super()) {
+        journal_dev = 0;
+        return 0;
+    }
+    journal_seq = 1;
+    journal_head = 0;
+    memory_set(dirty, 0, sizeof(dirty));
+    memory_set(logged, 0, sizeof(logged));
+    dirty_count = 0;
+    group_ops = 0;
+    return 1;
+}
+
+// Commit what is pending and go back to a RAM-only file system
+void journal_unmount() {
+    journal_commit();
+    journal_dev = 0;
+}
@@ -0,0 +1,90 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "types.h"
+#include "fs.h"
+
+// The file system on disk, with a write-ahead journal for its metadata.
+//
+//   sector 0          superblock
+//   JOURNAL_START     journal: transactions, one after the other
+//   TABLE_START       file table, RECORDS_PER_SECTOR entries per sector
+//   DATA_START        file contents, DATA_SECTORS_PER_FILE per slot
+//
+// A transaction is a descriptor sector (home sector of each block), new
+// copies of the changed table sectors, and a commit sector with a
+// checksum. Table sectors are only written in place (checkpointed) once
+// their transaction has committed, so a crash leaves either the old or the
+// new table. Replay after a crash reads at most JOURNAL_SECTORS sectors.
+// File contents are written in place before the commit that refers to them.
+
+#define SECTOR_SIZE 512
+#define FS_MAGIC 0x53464445      // "EDFS"
+#define FS_VERSION 1
+#define JOURNAL_DESC 0x4353444A  // "JDSC"
+#define JOURNAL_COMMIT 0x544D434A // "JCMT"
+
+#define JOURNAL_SECTORS 64
+#define JOURNAL_TXN_BLOCKS 30    // Table sectors per transaction
+#define JOURNAL_GROUP 32         // Operations per group commit
+
+#define RECORD_SIZE 64
+#define RECORDS_PER_SECTOR (SECTOR_SIZE / RECORD_SIZE)
+#define TABLE_SECTORS ((MAX_FILES + RECORDS_PER_SECTOR - 1) / RECORDS_PER_SECTOR)
+#define DATA_SECTORS_PER_FILE (MAX_FILESIZE / SECTOR_SIZE)
+#define JOURNAL_START 1
+#define TABLE_START (JOURNAL_START + JOURNAL_SECTORS)
+#define DATA_START (TABLE_START + TABLE_SECTORS)
+#define FS_DISK_SECTORS (DATA_START + MAX_FILES * DATA_SECTORS_PER_FILE)
+
+// A disk to keep the file system on (drivers/ata.c, or an image file on
+// the host). read/write/flush return 1 on success.
+typedef struct {
+    u32 sectors;
+    int (*read)(u32 lba, u32 count, void* buf);
+    int (*write)(u32 lba, u32 count, void* buf);
+    int (*flush)();
+} blockdev_t;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 max_files;
+    u32 journal_sectors;
+    u32 seq; // Sequence number of the first transaction to replay
+} superblock_t;
+
+typedef struct {
+    char name[MAX_FILENAME];
+    int size;
+    int used;
+    int type;
+    u8 reserved[RECORD_SIZE - MAX_FILENAME - 12];
+} fs_record_t;
+
+typedef struct {
+    u32 magic;
+    u32 seq;
+    u32 count;
+    u32 lba[JOURNAL_TXN_BLOCKS];
+} journal_desc_t;
+
+typedef struct {
+    u32 magic;
+    u32 seq;
+    u32 checksum; // Of the descriptor and blocks
+} journal_commit_t;
+
+extern blockdev_t* journal_dev; // 0 while the file system is RAM only
+extern int journal_group;
+extern u32 journal_commits;
+extern u32 journal_flushes;
+
+int journal_mount(blockdev_t* dev);
+int journal_format(blockdev_t* dev);
+void journal_unmount();
+int journal_slot_free(int slot);
+void journal_file_changed(int slot, int with_data);
+int journal_commit();
+
+#endif
@@ -1,9 +1,27 @@
 #include "../drivers/screen.h"
 #include "../drivers/keyboard.h"
 #include "../drivers/ports.h"
+#include "../drivers/serial.h"
 #include "../libc/string.h"
 #include "process.h"
 #include "fs.h"
+#include "bench.h"
+#include "bootinfo.h"
+#include "mem.h"
+#include "sched.h"
+#include "ipc.h"
+#include "pipeline.h"
+#include "syscall.h"
+#include "userprog.h"
+#include "vm.h"
+#include "elf.h"
+#include "timer.h"
+#include "search.h"
+#include "journal.h"
+#include "../cpu/gdt.h"
+#include "../cpu/simd.h"
+#include "../drivers/pit.h"
+#include "../drivers/ata.h"
 
 // Helper: Reboot
 void sys_reboot() {
@@ -11,42 +29,190 @@ void sys_reboot() {
     port_byte_out(0x64, 0xFE);
 }
 
+// Quiet boot (make QUIET_BOOT=1): no per-item messages while initialising
+#ifdef QUIET_BOOT
+int quiet_boot = 1;
+#else
+int quiet_boot = 0;
+#endif
+
+blockdev_t ata_disk = { 0, ata_read, ata_write, ata_flush };
+
+// Keep the file system on the second ATA disk if there is one: load it,
+// or put a new (empty) file system on it
+void init_disk() {
+    ata_disk.sectors = init_ata();
+    if (!ata_disk.sectors) return;
+    int replayed = journal_mount(&ata_disk);
+    if (replayed == -1) {
+        if (journal_format(&ata_disk)) fs_message("[FS] New file system on disk.\n");
+        return;
+    }
+    if (replayed < 0) return;
+    if (replayed > 0) fs_message("[FS] Journal replayed.\n");
+    if (fs_check(1)) kprint("[FS] Repaired file table.\n");
+    journal_commit();
+    fs_message("[FS] Loaded from disk.\n");
+}
+
 void kernel_main() {
+    boot_timing_start();
+    init_gdt();
+    init_simd();
     clear_screen();
+    init_serial();
     kprint("EduOS Kernel v1.2\n");
     kprint("Type 'help' for commands.\n\n");
     
+    fs_quiet = quiet_boot;
+    init_memory();
+    boot_mark("init_memory");
+    init_paging();
+    boot_mark("init_paging");
     init_process_manager();
+    init_scheduler();
+    init_ipc();
+    boot_mark("init_process_manager");
     init_fs();
+    boot_mark("init_fs");
+    init_disk();
+    boot_mark("init_disk");
     init_keyboard();
+    boot_mark("init_keyboard");
+    init_timer();
+    boot_mark("init_timer");
+    init_syscalls();
+    boot_mark("init_syscalls");
     
     kprint("root@EduOS:/$ ");
+    boot_mark("prompt");
+
+    // Deferred work: not needed to reach the prompt. Keyboard IRQs wait
+    // until the default files exist.
+    __asm__ volatile("cli");
+    fs_quiet = 1;
+    fs_populate();
+    elf_install_programs();
+    journal_commit();
+    fs_quiet = 0;
+    __asm__ volatile("sti");
+    boot_mark("fs_populate");
+    boot_report();
+
+#ifdef FS_STRESS
+    // Crash test image (make crash-test): change files until QEMU is killed
+    __asm__ volatile("cli");
+    fs_stress();
+#endif
+
+#ifdef BENCH_AUTORUN
+    // Headless benchmark image (make bench): run the suite and power off.
+    // Interrupts off, as when the shell runs it. Rates need the TSC
+    // frequency, which the PIT measures over its first ticks.
+    while (!tsc_per_tick) __asm__ volatile("hlt");
+    __asm__ volatile("cli");
+    run_benchmarks();
+    qemu_exit(0);
+#endif
+}
+
+void print_uptime() {
+    char num[12];
+    u32 seconds = uptime_seconds();
+    kprint("Up ");
+    int_to_ascii(seconds / 60, num);
+    kprint(num);
+    kprint("m ");
+    int_to_ascii(seconds % 60, num);
+    kprint(num);
+    kprint("s, ");
+    uint_to_ascii(system_timers.count, num);
+    kprint(num);
+    kprint(" timers pending\n");
+}
+
+// Run an ELF program and wait for it to exit
+void run_program(char* path) {
+    int pid = elf_exec(path);
+    if (pid) sched_join(pid);
+}
+
+// "hello" runs /bin/hello if it exists. Returns 0 if there is no such program.
+int run_bin(char* name) {
+    char path[MAX_FILENAME] = "/bin/";
+    if (strlen(name) + 5 >= MAX_FILENAME) return 0;
+    strcat(path, name);
+    File* f = fs_find(path);
+    if (!f || f->type == FS_DIR) return 0;
+    run_program(path);
+    return 1;
+}
+
+// Directory argument of grep/find as an absolute prefix ending in '/'
+// (the current directory if there is none). Returns 0 if it is too long.
+int search_dir(char* arg, char* dir) {
+    if (!arg[0]) {
+        strcpy(dir, cwd);
+        return 1;
+    }
+    if (!get_full_path(arg, dir)) return 0;
+    int len = strlen(dir);
+    if (dir[len - 1] == '/') return 1;
+    if (len + 1 >= MAX_FILENAME) {
+        kprint("Error: Path too long.\n");
+        return 0;
+    }
+    strcat(dir, "/");
+    return 1;
+}
+
+void grep_command(char* pattern, char* arg) {
+    char dir[MAX_FILENAME];
+    if (!search_dir(arg, dir)) return;
+    if (search_grep(pattern, dir, 0) == 0) kprint("No matches.\n");
 }
 
-void get_args(char* input, char* arg1, char* arg2) {
-    int i = 0;
-    while(input[i] != ' ' && input[i] != '\0') i++;
-    if (input[i] == ' ') i++;
-    int j = 0;
-    while(input[i] != ' ' && input[i] != '\0') {
-        arg1[j] = input[i]; i++; j++;
-    }
-    arg1[j] = '\0';
-    if (input[i] == ' ') i++;
-    j = 0;
-    while(input[i] != '\0') {
-        arg2[j] = input[i]; i++; j++;
-    }
-    arg2[j] = '\0';
+void find_command(char* text, char* arg) {
+    char dir[MAX_FILENAME];
+    if (!search_dir(arg, dir)) return;
+    if (search_find(text, dir) == 0) kprint("No matches.\n");
+}
+
+// "compress": storage totals and how often reads hit the decoded cache
+void compress_status() {
+    char num[12];
+    u32 raw = 0, stored = 0;
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!file_system[i].used) continue;
+        raw += file_system[i].size;
+        stored += file_system[i].stored;
+    }
+    kprint(fs_compress ? "Compression on. " : "Compression off. ");
+    uint_to_ascii(stored, num);
+    kprint(num);
+    kprint(" B stored for ");
+    uint_to_ascii(raw, num);
+    kprint(num);
+    kprint(" B of contents. Cache: ");
+    uint_to_ascii(fs_cache_hits, num);
+    kprint(num);
+    kprint(" hits, ");
+    uint_to_ascii(fs_cache_misses, num);
+    kprint(num);
+    kprint(" misses.\n");
 }
 
 void user_input(char *input) {
-    char arg1[20] = ""; 
-    char arg2[20] = ""; 
-    get_args(input, arg1, arg2); 
+    char arg1[MAX_FILENAME] = ""; 
+    char arg2[MAX_FILENAME] = ""; 
+    get_args(input, arg1, arg2, MAX_FILENAME); 
 
+    // --- PIPELINES: "cat a.txt | grep x" ---
+    if (is_pipeline(input)) {
+        run_pipeline(input);
+    }
     // --- CD.. FIX (Handle missing space) ---
-    if (strcasecmp(input, "cd..") == 0) {
+    else if (strcasecmp(input, "cd..") == 0) {
         fs_cd("..");
     }
     // --- STANDARD COMMANDS ---
@@ -63,13 +229,31 @@ void user_input(char *input) {
         kprint("  rm [name]     - Delete file\n");
         kprint("  cp [src] [dst]- Copy file\n");
         kprint("  mv [old] [new]- Rename/Move file\n");
+        kprint("  grep [t] [dir]- Find files containing text\n");
+        kprint("  find [t] [dir]- Find files with text in their name\n");
+        kprint("  index on|off  - Trigram index for grep\n");
+        kprint("  compress [on|off] - Compressed file storage\n");
+        kprint("  sync          - Commit file changes to disk\n");
+        kprint("  fsck          - Check the file table\n");
+        kprint("  a | b         - Pipe (cat, echo, grep, wc)\n");
         kprint("\nSystem Commands:\n");
         kprint("  echo [text]   - Print text\n");
         kprint("  whoami        - Print user\n");
         kprint("  clear         - Clear screen\n");
         kprint("  reboot        - Restart system\n");
         kprint("  monitor       - Task Manager\n");
-        kprint("  start         - Start dummy process\n");
+        kprint("  start [n]     - Start n dummy processes\n");
+        kprint("  kill [pid]    - Terminate a process\n");
+        kprint("  wait [pid]    - Wait for a process to exit, reap it\n");
+        kprint("  alloc [pid] [bytes] - Allocate heap memory for a process\n");
+        kprint("  limit [pid] [pages] - Set a process memory limit\n");
+        kprint("  usertest      - Run a demo program in user mode\n");
+        kprint("  exec [file]   - Run an ELF program (or type its name in /bin)\n");
+        kprint("  meminfo       - Show BIOS memory map\n");
+        kprint("  boottime      - Show boot phase timings\n");
+        kprint("  uptime        - Time since boot\n");
+        kprint("  sleep [s]     - Wait for s seconds\n");
+        kprint("  bench         - Run benchmark suite\n");
     }
     else if (strcasecmp(input, "clear") == 0) { clear_screen(); }
     else if (strcasecmp(input, "whoami") == 0) { kprint("root\n"); }
@@ -108,13 +292,89 @@ void user_input(char *input) {
     else if (strcasecmp_prefix(input, "mv")) { 
         if (arg1[0] && arg2[0]) fs_rename(arg1, arg2); else kprint("Usage: mv [old] [new]\n");
     }
+    else if (strcasecmp_prefix(input, "grep")) {
+        if (arg1[0]) grep_command(arg1, arg2); else kprint("Usage: grep [text] [dir]\n");
+    }
+    else if (strcasecmp_prefix(input, "find")) {
+        if (arg1[0]) find_command(arg1, arg2); else kprint("Usage: find [text] [dir]\n");
+    }
+    else if (strcasecmp_prefix(input, "index")) {
+        if (strcasecmp(arg1, "on") == 0) { index_enable(1); kprint("Index on.\n"); }
+        else if (strcasecmp(arg1, "off") == 0) { index_enable(0); kprint("Index off.\n"); }
+        else kprint("Usage: index on|off\n");
+    }
+    else if (strcasecmp_prefix(input, "compress")) {
+        int on = strcasecmp(arg1, "on") == 0;
+        if (arg1[0] && !on && strcasecmp(arg1, "off") != 0) kprint("Usage: compress [on|off]\n");
+        else {
+            if (arg1[0]) fs_set_compress(on);
+            compress_status();
+        }
+    }
+    else if (strcasecmp(input, "sync") == 0) {
+        if (!journal_dev) kprint("No disk.\n");
+        else if (journal_commit()) kprint("Synced.\n");
+    }
+    else if (strcasecmp(input, "fsck") == 0) {
+        if (fs_check(0) == 0) kprint("File table clean.\n");
+    }
     else if (strcasecmp(input, "monitor") == 0) { list_processes(); }
-    else if (strcasecmp(input, "start") == 0) { create_process("Worker", 1024); }
+    else if (strcasecmp_prefix(input, "start")) {
+        int count = arg1[0] ? ascii_to_int(arg1) : 1;
+        if (count < 0) kprint("Usage: start [count]\n");
+        for (int i = 0; i < count; i++) {
+            if (!create_process("Worker", 1024)) break;
+        }
+    }
+    else if (strcasecmp_prefix(input, "kill")) {
+        int pid = ascii_to_int(arg1);
+        if (pid < 0) kprint("Usage: kill [pid]\n");
+        else if (kill_process(pid)) kprint("Killed.\n");
+    }
+    else if (strcasecmp_prefix(input, "wait")) {
+        int pid = ascii_to_int(arg1);
+        if (pid < 0) kprint("Usage: wait [pid]\n");
+        else if (sched_join(pid)) kprint("Reaped.\n");
+    }
+    else if (strcasecmp_prefix(input, "alloc")) {
+        Process* p = find_process(ascii_to_int(arg1));
+        int size = ascii_to_int(arg2);
+        if (!p || size < 0) kprint("Usage: alloc [pid] [bytes]\n");
+        else if (p->state == TERMINATED) kprint("Error: Process terminated.\n");
+        else if (proc_malloc(p, size)) kprint("Allocated.\n");
+        else kprint("Error: Allocation failed (limit reached or out of memory).\n");
+    }
+    else if (strcasecmp_prefix(input, "limit")) {
+        Process* p = find_process(ascii_to_int(arg1));
+        int pages = ascii_to_int(arg2);
+        if (!p || pages < 0) kprint("Usage: limit [pid] [pages]\n");
+        else { p->mem_limit = pages; kprint("Limit set.\n"); }
+    }
+    else if (strcasecmp(input, "usertest") == 0) {
+        int pid = create_user_thread("UserDemo", user_demo);
+        if (pid) sched_join(pid);
+    }
+    else if (strcasecmp_prefix(input, "exec")) {
+        if (arg1[0]) run_program(arg1); else kprint("Usage: exec [file]\n");
+    }
+    else if (strcasecmp(input, "meminfo") == 0) { boot_print_mmap(); mem_print_stats(); }
+    else if (strcasecmp(input, "boottime") == 0) { boot_print_times(); }
+    else if (strcasecmp(input, "uptime") == 0) { print_uptime(); }
+    else if (strcasecmp_prefix(input, "sleep")) {
+        int seconds = ascii_to_int(arg1);
+        if (seconds < 0) kprint("Usage: sleep [seconds]\n");
+        else if (seconds > TIMER_MAX_DELAY / TIMER_HZ) kprint("Error: Sleep too long.\n");
+        else sched_sleep(seconds * 1000);
+    }
+    else if (strcasecmp(input, "bench") == 0) { run_benchmarks(); }
     else if (strcmp(input, "") == 0) {} 
-    else {
+    else if (!run_bin(input)) {
         kprint("Unknown command: "); kprint(input); kprint("\n");
     }
     
+    // Group commit: what the command changed reaches the disk together
+    journal_commit();
+
     // --- UPDATED PROMPT: Shows Current Directory ---
     kprint("root@EduOS:");
     kprint(cwd); // Prints /home/ or /
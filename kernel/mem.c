@@ -0,0 +1,122 @@
+#include "mem.h"
+#include "bootinfo.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+// Physical page allocator. Pages handed back with page_free() go on a
+// free list (the link lives in the page itself); otherwise we bump through
+// the usable E820 regions above the kernel, so init touches no memory.
+
+extern char _end[]; // End of the kernel's .bss (linker)
+
+typedef struct free_page {
+    struct free_page* next;
+} free_page_t;
+
+free_page_t* free_pages = 0;
+u32 region_next = 0;  // Next never-used page in the current region
+u32 region_end = 0;
+u32 region_index = 0; // Next E820 entry to look at
+u32 kernel_end = 0;
+
+u32 pages_total = 0;
+u32 pages_used = 0;
+
+// Usable part of E820 entry i, page aligned and above the kernel.
+// Returns 0 if nothing is left of it.
+int mem_region_bounds(u32 i, u32* start, u32* end) {
+    mmap_entry_t* e = &boot_info->mmap[i];
+    if (e->type != MMAP_USABLE || e->base_high != 0) return 0;
+
+    u32 s = e->base_low;
+    u32 t = e->base_low + e->length_low;
+    if (e->length_high != 0 || t < s) t = 0xFFFFF000; // Clip at 4 GiB
+    if (t > MEM_LIMIT) t = MEM_LIMIT;
+    if (s < kernel_end) s = kernel_end;
+
+    s = PAGE_ALIGN_UP(s);
+    t = t & ~(PAGE_SIZE - 1);
+    if (s >= t) return 0;
+    *start = s;
+    *end = t;
+    return 1;
+}
+
+int mem_next_region() {
+    while (region_index < boot_info->mmap_count) {
+        if (mem_region_bounds(region_index++, &region_next, &region_end)) return 1;
+    }
+    return 0;
+}
+
+void init_memory() {
+    u32 start, end;
+    kernel_end = PAGE_ALIGN_UP((u32)_end);
+
+    if (boot_info->mmap_count == 0) {
+        region_next = kernel_end;
+        region_end = MEM_FALLBACK_END;
+        pages_total = (region_end - region_next) / PAGE_SIZE;
+        return;
+    }
+
+    for (u32 i = 0; i < boot_info->mmap_count; i++) {
+        if (mem_region_bounds(i, &start, &end)) pages_total += (end - start) / PAGE_SIZE;
+    }
+    mem_next_region();
+}
+
+// One 4 KiB page, contents undefined. Returns 0 when memory is exhausted.
+void* page_alloc() {
+    void* page = 0;
+    if (free_pages) {
+        page = free_pages;
+        free_pages = free_pages->next;
+    } else {
+        if (region_next >= region_end && !mem_next_region()) return 0;
+        page = (void*)region_next;
+        region_next += PAGE_SIZE;
+    }
+    pages_used++;
+    return page;
+}
+
+// count physically contiguous pages (stacks). Only the never-used part of
+// a region is known to be contiguous, so the free list is not searched.
+void* page_alloc_contig(u32 count) {
+    if (count == 1) return page_alloc();
+
+    while (region_end - region_next < count * PAGE_SIZE) {
+        // Not enough room left here: recycle the tail, move on
+        while (region_next < region_end) {
+            free_page_t* p = (free_page_t*)region_next;
+            p->next = free_pages;
+            free_pages = p;
+            region_next += PAGE_SIZE;
+        }
+        if (!mem_next_region()) return 0;
+    }
+
+    void* pages = (void*)region_next;
+    region_next += count * PAGE_SIZE;
+    pages_used += count;
+    return pages;
+}
+
+void page_free(void* page) {
+    free_page_t* p = (free_page_t*)page;
+    p->next = free_pages;
+    free_pages = p;
+    pages_used--;
+}
+
+void mem_print_stats() {
+    char buffer[20];
+    kprint("Pages: ");
+    uint_to_ascii(pages_used, buffer);
+    kprint(buffer);
+    kprint(" used / ");
+    uint_to_ascii(pages_total, buffer);
+    kprint(buffer);
+    kprint(" total (4 KB each)\n");
+}
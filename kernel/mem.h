@@ -0,0 +1,25 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include "types.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_ALIGN_UP(x) (((x) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+
+// Used when the BIOS gave no E820 map: assume RAM up to 16 MiB
+#define MEM_FALLBACK_END 0x1000000
+
+// Only the identity-mapped first 1 GiB is used; above it every address
+// space belongs to user programs (USER_BASE in vm.h)
+#define MEM_LIMIT 0x40000000
+
+extern u32 pages_total;
+extern u32 pages_used;
+
+void init_memory();
+void* page_alloc();
+void* page_alloc_contig(u32 count);
+void page_free(void* page);
+void mem_print_stats();
+
+#endif
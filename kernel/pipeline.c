@@ -0,0 +1,178 @@
+#include "pipeline.h"
+#include "sched.h"
+#include "fs.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+// Shell pipelines ("cat a.txt | grep x | wc"). Every stage is a kernel
+// thread; stages are connected with pipes and the shell waits for all of
+// them. Only commands that know how to use stage_write/stage_read_line
+// can take part.
+
+int is_pipeline(char* input) {
+    for (int i = 0; input[i] != '\0'; i++) {
+        if (input[i] == '|') return 1;
+    }
+    return 0;
+}
+
+void stage_write(stage_t* s, char* text) {
+    if (s->out) pipe_write(s->out, text, strlen(text));
+    else kprint(text);
+}
+
+// Next input line (without the newline) into s->line. Returns 0 at end of
+// input. Over-long lines are truncated.
+int stage_read_line(stage_t* s) {
+    int len = 0;
+    if (!s->in) return 0;
+    for (;;) {
+        if (s->in_pos == s->in_len) {
+            int n = pipe_read(s->in, s->inbuf, STAGE_LINE);
+            if (n <= 0) {
+                s->line[len] = '\0';
+                return len > 0;
+            }
+            s->in_len = n;
+            s->in_pos = 0;
+        }
+        char c = s->inbuf[s->in_pos++];
+        if (c == '\n') {
+            s->line[len] = '\0';
+            return 1;
+        }
+        if (len < STAGE_LINE - 1) s->line[len++] = c;
+    }
+}
+
+void stage_cat(stage_t* s, char* name) {
+    File* f = fs_find(name);
+    if (!f) stage_write(s, "Error: Not found.\n");
+    else if (f->type == FS_DIR) stage_write(s, "Error: Is a directory.\n");
+    else {
+        // Our own copy: stage_write can block, and other stages may read
+        // files meanwhile (fs_data's cache is shared)
+        char text[MAX_FILESIZE + 1];
+        fs_load(f, text);
+        stage_write(s, text);
+        stage_write(s, "\n");
+    }
+}
+
+void stage_grep(stage_t* s, char* pattern) {
+    while (stage_read_line(s)) {
+        if (str_find(s->line, pattern) >= 0) {
+            stage_write(s, s->line);
+            stage_write(s, "\n");
+        }
+    }
+}
+
+void stage_wc(stage_t* s) {
+    char buffer[20];
+    int lines = 0, words = 0, bytes = 0;
+    while (stage_read_line(s)) {
+        lines++;
+        bytes += strlen(s->line) + 1;
+        for (int i = 0; s->line[i] != '\0'; i++) {
+            if (s->line[i] != ' ' && (i == 0 || s->line[i-1] == ' ')) words++;
+        }
+    }
+    int_to_ascii(lines, buffer); stage_write(s, buffer); stage_write(s, " ");
+    int_to_ascii(words, buffer); stage_write(s, buffer); stage_write(s, " ");
+    int_to_ascii(bytes, buffer); stage_write(s, buffer); stage_write(s, "\n");
+}
+
+// Thread entry for one stage
+void run_stage(void* arg) {
+    stage_t* s = (stage_t*)arg;
+    char arg1[MAX_FILENAME];
+    char arg2[MAX_FILENAME];
+    get_args(s->text, arg1, arg2, MAX_FILENAME);
+
+    if (strcasecmp_prefix(s->text, "cat")) {
+        if (arg1[0]) stage_cat(s, arg1); else stage_write(s, "Usage: cat [file]\n");
+    }
+    else if (strcasecmp_prefix(s->text, "echo")) {
+        if (strlen(s->text) > 5) stage_write(s, s->text + 5);
+        stage_write(s, "\n");
+    }
+    else if (strcasecmp_prefix(s->text, "grep")) {
+        if (arg1[0]) stage_grep(s, arg1); else stage_write(s, "Usage: grep [text]\n");
+    }
+    else if (strcasecmp_prefix(s->text, "wc")) { stage_wc(s); }
+    else {
+        stage_write(s, "Unknown command in pipeline: ");
+        stage_write(s, s->text);
+        stage_write(s, "\n");
+    }
+
+    if (s->in) pipe_close_reader(s->in);
+    if (s->out) pipe_close_writer(s->out);
+}
+
+// Split the line on '|'. Returns the number of stages, 0 on error.
+int split_pipeline(char* input, stage_t* stages) {
+    int count = 0;
+    int i = 0;
+    for (;;) {
+        if (count == PIPELINE_MAX) {
+            kprint("Error: Too many pipeline stages.\n");
+            return 0;
+        }
+        while (input[i] == ' ') i++;
+        int j = 0;
+        while (input[i] != '|' && input[i] != '\0') {
+            if (j < STAGE_TEXT - 1) stages[count].text[j++] = input[i];
+            i++;
+        }
+        while (j > 0 && stages[count].text[j-1] == ' ') j--;
+        stages[count].text[j] = '\0';
+        if (j == 0) {
+            kprint("Error: Empty pipeline stage.\n");
+            return 0;
+        }
+        count++;
+        if (input[i] == '\0') return count;
+        i++; // Skip '|'
+    }
+}
+
+void run_pipeline(char* input) {
+    stage_t stages[PIPELINE_MAX];
+    int pids[PIPELINE_MAX];
+    int count = split_pipeline(input, stages);
+    if (count == 0) return;
+
+    for (int k = 0; k < count; k++) {
+        stages[k].in = 0;
+        stages[k].out = 0;
+        stages[k].in_len = 0;
+        stages[k].in_pos = 0;
+    }
+    for (int k = 0; k + 1 < count; k++) {
+        pipe_t* pipe = pipe_create();
+        if (!pipe) {
+            kprint("Error: Out of memory for pipe.\n");
+            for (int j = 0; j < k; j++) {
+                pipe_close_writer(stages[j].out);
+                pipe_close_reader(stages[j + 1].in);
+            }
+            return;
+        }
+        stages[k].out = pipe;
+        stages[k + 1].in = pipe;
+    }
+
+    for (int k = 0; k < count; k++) {
+        pids[k] = create_thread(stages[k].text, run_stage, &stages[k]);
+        if (!pids[k]) {
+            // Let the neighbours see end of file / a broken pipe
+            if (stages[k].in) pipe_close_reader(stages[k].in);
+            if (stages[k].out) pipe_close_writer(stages[k].out);
+        }
+    }
+    for (int k = 0; k < count; k++) {
+        if (pids[k]) sched_join(pids[k]);
+    }
+}
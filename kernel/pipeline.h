@@ -0,0 +1,24 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "ipc.h"
+
+#define PIPELINE_MAX 4    // Stages per command line
+#define STAGE_TEXT 80
+#define STAGE_LINE 128
+
+// One command of a pipeline, run as its own kernel thread
+typedef struct {
+    char text[STAGE_TEXT];
+    pipe_t* in;           // 0: no input
+    pipe_t* out;          // 0: the console
+    char line[STAGE_LINE];
+    char inbuf[STAGE_LINE];
+    int in_len;
+    int in_pos;
+} stage_t;
+
+int is_pipeline(char* input);
+void run_pipeline(char* input);
+
+#endif
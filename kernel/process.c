@@ -1,74 +1,303 @@
 #include "process.h"
+#include "slab.h"
+#include "mem.h"
+#include "vm.h"
 #include "../drivers/screen.h"
 #include "../libc/string.h"
 
-Process process_list[MAX_PROCESSES];
+// Process table: entries come from a slab cache (freed slots are reused),
+// are linked in creation order for listing, and are found by PID through
+// a hash table. PIDs are never reused.
+slab_cache_t process_cache;
+slab_cache_t page_ref_cache;
+Process* pid_hash[PID_HASH_SIZE];
+Process* process_head = 0;
+Process* process_tail = 0;
 int process_count = 0;
+int next_pid = FIRST_PID;
 
 void init_process_manager() {
+    slab_init(&process_cache, "process", sizeof(Process));
+    slab_init(&page_ref_cache, "page_ref", sizeof(page_ref_t));
+    for (int i = 0; i < PID_HASH_SIZE; i++) pid_hash[i] = 0;
+    process_head = process_tail = 0;
+    process_count = 0;
+    next_pid = FIRST_PID;
+
     // Create a base process so the list isn't empty
-    create_process("KERNEL", 4096);
-    process_list[0].state = RUNNING; // The kernel is always running
+    int pid = create_process("KERNEL", 4096);
+    if (pid) find_process(pid)->state = RUNNING; // The kernel is always running
     
-    create_process("SHELL", 2048);
-    process_list[1].state = RUNNING;
+    pid = create_process("SHELL", 2048);
+    if (pid) find_process(pid)->state = RUNNING;
+}
+
+// --- Memory accounting ---
+
+// Record that p owns page; fails (0) if the bookkeeping itself cannot be
+// allocated.
+int proc_own_page(Process* p, void* page) {
+    page_ref_t* ref = (page_ref_t*)slab_alloc(&page_ref_cache);
+    if (!ref) return 0;
+    ref->page = page;
+    ref->next = p->owned;
+    p->owned = ref;
+
+    p->pages++;
+    if (p->pages > p->peak_pages) p->peak_pages = p->pages;
+    return 1;
+}
+
+// Stop tracking page as p's (ownership handed to someone else)
+int proc_disown_page(Process* p, void* page) {
+    page_ref_t** link = &p->owned;
+    while (*link && (*link)->page != page) link = &(*link)->next;
+    if (!*link) return 0;
+
+    page_ref_t* ref = *link;
+    *link = ref->next;
+    slab_free(&page_ref_cache, ref);
+    p->pages--;
+    return 1;
+}
+
+// Give a page back early instead of at exit
+void proc_page_free(Process* p, void* page) {
+    if (proc_disown_page(p, page)) page_free(page);
+}
+
+// One page charged to p. Returns 0 if that would exceed p's limit or RAM
+// is exhausted; nothing else is touched in that case.
+void* proc_charge_page(Process* p) {
+    if (p->pages >= p->mem_limit) return 0;
+    void* page = page_alloc();
+    if (!page) return 0;
+    if (!proc_own_page(p, page)) {
+        page_free(page);
+        return 0;
+    }
+    return page;
 }
 
-void create_process(char* name, int memory) {
-    if (process_count >= MAX_PROCESSES) {
-        kprint("Error: Max processes reached.\n");
-        return;
+void* proc_page_alloc(Process* p) {
+    void* page = proc_charge_page(p);
+    if (page) p->alloc_count++;
+    else p->failed_allocs++;
+    return page;
+}
+
+// Heap memory from p's arenas (one page each, bump allocated). Blocks are
+// not freed individually; the arenas go away with the process.
+void* proc_malloc(Process* p, u32 size) {
+    size = (size + PROC_HEAP_ALIGN - 1) & ~(PROC_HEAP_ALIGN - 1);
+    if (size == 0 || size > PAGE_SIZE) {
+        p->failed_allocs++;
+        return 0;
+    }
+    if (size > p->arena_left) {
+        char* arena = (char*)proc_charge_page(p);
+        if (!arena) {
+            p->failed_allocs++;
+            return 0;
+        }
+        p->arena_next = arena;
+        p->arena_left = PAGE_SIZE;
     }
 
-    Process p;
-    p.pid = 1000 + process_count; // PIDs start at 1000
-    // Manually copy string since we don't have strcpy yet
-    int i = 0;
-    while(name[i] != '\0' && i < 19) {
-        p.name[i] = name[i];
-        i++;
+    void* block = p->arena_next;
+    p->arena_next += size;
+    p->arena_left -= size;
+    p->alloc_count++;
+    return block;
+}
+
+// Give back everything p owns
+void proc_release_memory(Process* p) {
+    vm_destroy(p); // Unmaps shared pages; the page tables are owned pages
+    page_ref_t* ref = p->owned;
+    while (ref) {
+        page_ref_t* next = ref->next;
+        page_free(ref->page);
+        slab_free(&page_ref_cache, ref);
+        ref = next;
     }
-    p.name[i] = '\0';
-    
-    p.state = READY;
-    p.memory_usage = memory;
+    p->owned = 0;
+    p->pages = 0;
+    p->stack = 0;
+    p->stack_pages = 0;
+    p->arena_next = 0;
+    p->arena_left = 0;
+}
+
+// Stack pages must be contiguous, so they come from page_alloc_contig
+int proc_alloc_stack(Process* p, int stack_size) {
+    u32 count = PAGE_ALIGN_UP(stack_size) / PAGE_SIZE;
+    if (count == 0) count = 1;
+    if (count > p->mem_limit) return 0;
+
+    char* stack = (char*)page_alloc_contig(count);
+    if (!stack) return 0;
+    for (u32 i = 0; i < count; i++) {
+        if (!proc_own_page(p, stack + i * PAGE_SIZE)) {
+            // Pages already recorded are released with the rest
+            for (u32 j = i; j < count; j++) page_free(stack + j * PAGE_SIZE);
+            return 0;
+        }
+    }
+    p->stack = stack;
+    p->stack_pages = count;
+    return 1;
+}
+
+// --- Process table ---
+
+// Returns the new PID, or 0 if there is no memory left
+int create_process(char* name, int stack_size) {
+    Process* p = (Process*)slab_alloc(&process_cache);
+    if (!p) {
+        kprint("Error: Out of memory for processes.\n");
+        return 0;
+    }
+
+    strlcpy(p->name, name, sizeof(p->name));
+    p->state = READY;
+    p->owned = 0;
+    p->arena_next = 0;
+    p->arena_left = 0;
+    p->pages = 0;
+    p->peak_pages = 0;
+    p->mem_limit = PROC_DEFAULT_LIMIT;
+    p->alloc_count = 0;
+    p->failed_allocs = 0;
+    p->esp = 0;
+    p->entry = 0;
+    p->arg = 0;
+    p->page_dir = 0;
+    p->areas = 0;
+    if (!proc_alloc_stack(p, stack_size)) {
+        proc_release_memory(p);
+        slab_free(&process_cache, p);
+        kprint("Error: Out of memory for process stack.\n");
+        return 0;
+    }
+    p->pid = next_pid++;
+
+    // Append to the list
+    p->next = 0;
+    p->prev = process_tail;
+    if (process_tail) process_tail->next = p;
+    else process_head = p;
+    process_tail = p;
+
+    // Insert in the hash
+    int bucket = p->pid & (PID_HASH_SIZE - 1);
+    p->hash_next = pid_hash[bucket];
+    pid_hash[bucket] = p;
 
-    process_list[process_count] = p;
     process_count++;
+    return p->pid;
+}
+
+Process* find_process(int pid) {
+    Process* p = pid_hash[pid & (PID_HASH_SIZE - 1)];
+    while (p && p->pid != pid) p = p->hash_next;
+    return p;
+}
+
+// Terminate a process and free its memory; the entry stays listed until
+// someone waits for it
+int kill_process(int pid) {
+    Process* p = find_process(pid);
+    if (!p) {
+        kprint("Error: No such process.\n");
+        return 0;
+    }
+    if (pid < FIRST_USER_PID) {
+        kprint("Error: Cannot kill a system process.\n");
+        return 0;
+    }
+    if (p->state == TERMINATED) {
+        kprint("Error: Process already terminated.\n");
+        return 0;
+    }
+    p->state = TERMINATED;
+    proc_release_memory(p);
+    return 1;
+}
+
+// Reap a terminated process and give its slot back. There is no scheduler
+// to block on yet, so waiting for a live process fails instead.
+int wait_process(int pid) {
+    Process* p = find_process(pid);
+    if (!p) {
+        kprint("Error: No such process.\n");
+        return 0;
+    }
+    if (p->state != TERMINATED) {
+        kprint("Error: Process still running.\n");
+        return 0;
+    }
+
+    Process** link = &pid_hash[pid & (PID_HASH_SIZE - 1)];
+    while (*link != p) link = &(*link)->hash_next;
+    *link = p->hash_next;
+
+    if (p->prev) p->prev->next = p->next;
+    else process_head = p->next;
+    if (p->next) p->next->prev = p->prev;
+    else process_tail = p->prev;
+
+    slab_free(&process_cache, p);
+    process_count--;
+    return 1;
+}
+
+void print_padded_uint(u32 n, int width) {
+    char buffer[20];
+    uint_to_ascii(n, buffer);
+    for (int i = strlen(buffer); i < width; i++) kprint(" ");
+    kprint(buffer);
 }
 
 void list_processes() {
-    kprint("\nPID   | STATE | MEMORY | NAME\n");
-    kprint("----------------------------------\n");
+    kprint("\nPID   | STATE | RES KB | PEAK KB | ALLOCS | NAME\n");
+    kprint("------------------------------------------------\n");
     
     char buffer[20]; // Buffer for number-to-string conversion
     
-    for (int i = 0; i < process_count; i++) {
-        Process p = process_list[i];
-        
+    for (Process* p = process_head; p; p = p->next) {
         // Print PID
-        int_to_ascii(p.pid, buffer);
+        int_to_ascii(p->pid, buffer);
         kprint(buffer);
-        kprint("  |   ");
+        kprint("  |  ");
         
         // Print State
-        if (p.state == RUNNING) kprint("RUN");
-        else if (p.state == READY) kprint("RDY");
-        else kprint("BLK");
-        
-        kprint("   |  ");
+        if (p->state == RUNNING) kprint("RUN");
+        else if (p->state == READY) kprint("RDY");
+        else if (p->state == BLOCKED) kprint("BLK");
+        else kprint("TRM");
         
-        // Print Memory
-        int_to_ascii(p.memory_usage, buffer);
-        kprint(buffer);
-        kprint("B");
+        kprint("  | ");
         
-        // Align spacing (simple tab simulation)
-        if (p.memory_usage < 1000) kprint("   | ");
-        else kprint("  | ");
+        // Print Memory (resident, peak, allocation count)
+        print_padded_uint(p->pages * (PAGE_SIZE / 1024), 6);
+        kprint(" | ");
+        print_padded_uint(p->peak_pages * (PAGE_SIZE / 1024), 7);
+        kprint(" | ");
+        print_padded_uint(p->alloc_count, 6);
+        kprint(" | ");
 
-        kprint(p.name);
+        kprint(p->name);
+        if (p->failed_allocs) {
+            kprint(" (");
+            uint_to_ascii(p->failed_allocs, buffer);
+            kprint(buffer);
+            kprint(" failed)");
+        }
         kprint("\n");
     }
-    kprint("\n");
-}
\ No newline at end of file
+
+    int_to_ascii(process_count, buffer);
+    kprint(buffer);
+    kprint(" processes\n\n");
+}
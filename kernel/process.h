@@ -9,17 +9,66 @@
 #define BLOCKED 2
 #define TERMINATED 3
 
-#define MAX_PROCESSES 10
+#define FIRST_PID 1000     // KERNEL, then SHELL
+#define FIRST_USER_PID 1002
+#define PID_HASH_SIZE 1024 // Power of two
 
-typedef struct {
+#define PROC_DEFAULT_LIMIT 64  // Pages (256 KB) a process may own
+#define PROC_HEAP_ALIGN 8
+
+// One page owned by a process, freed when the process exits
+typedef struct page_ref {
+    void* page;
+    struct page_ref* next;
+} page_ref_t;
+
+typedef void (*thread_entry_t)(void* arg);
+
+typedef struct process {
     int pid;          // Process ID (e.g., 1001)
     char name[20];    // Name (e.g., "Shell")
     int state;        // 0=Ready, 1=Running...
-    int memory_usage; // Fake memory usage in bytes
+
+    // Memory charged to the process
+    void* stack;            // Lowest address of the stack
+    u32 stack_pages;
+    page_ref_t* owned;      // Every page it owns (stack and heap)
+    char* arena_next;       // Bump pointer in the current heap page
+    u32 arena_left;
+    u32 pages;              // Resident pages
+    u32 peak_pages;
+    u32 mem_limit;          // Max resident pages
+    u32 alloc_count;        // Successful proc_malloc/proc_page_alloc calls
+    u32 failed_allocs;
+
+    // Kernel thread (see sched.c); esp is 0 for processes with no code
+    u32 esp;
+    thread_entry_t entry;
+    void* arg;
+
+    // User address space (see vm.c); 0 for kernel threads
+    u32* page_dir;
+    struct vm_area* areas;
+    u32 heap_next;             // Bump pointer in the heap area (vm_malloc)
+
+    struct process* next;      // Process list, in creation order
+    struct process* prev;
+    struct process* hash_next; // PID hash chain
 } Process;
 
+extern int process_count;
+
 void init_process_manager();
-void create_process(char* name, int memory);
+int create_process(char* name, int stack_size);
+Process* find_process(int pid);
+int kill_process(int pid);
+int wait_process(int pid);
 void list_processes();
+void* proc_page_alloc(Process* p);
+void* proc_malloc(Process* p, u32 size);
+int proc_own_page(Process* p, void* page);
+int proc_disown_page(Process* p, void* page);
+void proc_page_free(Process* p, void* page);
+void proc_release_memory(Process* p);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,163 @@
+#include "sched.h"
+#include "mem.h"
+#include "vm.h"
+#include "timer.h"
+#include "../cpu/gdt.h"
+#include "../drivers/screen.h"
+
+// Cooperative scheduler for kernel threads. A thread runs until it
+// blocks, yields or exits. The run queue holds PIDs rather than pointers,
+// so a process that is killed and reaped while queued is simply skipped.
+
+void switch_context(u32* old_esp, u32 new_esp); // cpu/switch.asm
+
+Process* current = 0;
+int runq[RUNQ_SIZE];
+u32 runq_head = 0; // Next to run
+u32 runq_tail = 0; // Next free slot
+
+void runq_push(int pid) {
+    if (runq_tail - runq_head >= RUNQ_SIZE) {
+        kprint("Error: Run queue full.\n");
+        return;
+    }
+    runq[runq_tail++ & (RUNQ_SIZE - 1)] = pid;
+}
+
+// The kernel's boot context becomes the KERNEL process
+void init_scheduler() {
+    current = find_process(FIRST_PID);
+    runq_head = runq_tail = 0;
+}
+
+// First thing a new thread runs (switch_context "returns" here)
+void thread_start() {
+    current->entry(current->arg);
+    thread_exit();
+}
+
+int create_thread(char* name, thread_entry_t entry, void* arg) {
+    int pid = create_process(name, THREAD_STACK_SIZE);
+    if (!pid) return 0;
+    Process* p = find_process(pid);
+
+    // Initial frame, popped by switch_context
+    u32* sp = (u32*)((char*)p->stack + p->stack_pages * PAGE_SIZE);
+    *--sp = 0;                // thread_start never returns
+    *--sp = (u32)thread_start;
+    *--sp = 0;                // ebp
+    *--sp = 0;                // ebx
+    *--sp = 0;                // esi
+    *--sp = 0;                // edi
+    *--sp = THREAD_EFLAGS;
+    p->esp = (u32)sp;
+    p->entry = entry;
+    p->arg = arg;
+
+    runq_push(pid);
+    return pid;
+}
+
+// Switch to the next ready thread. The current one is re-queued if it is
+// still runnable. Returns 0 if nothing else could run.
+int schedule() {
+    Process* next = 0;
+    while (runq_head != runq_tail) {
+        Process* p = find_process(runq[runq_head++ & (RUNQ_SIZE - 1)]);
+        if (p && p != current && p->state == READY && p->esp) {
+            next = p;
+            break;
+        }
+    }
+    if (!next) return 0;
+
+    Process* prev = current;
+    if (prev->state == RUNNING) {
+        prev->state = READY;
+        runq_push(prev->pid);
+    }
+    next->state = RUNNING;
+    current = next;
+    // Entries from ring 3 land on the top of the thread's own stack
+    if (next->stack) tss_set_kernel_stack((u32)next->stack + next->stack_pages * PAGE_SIZE);
+    if (next->page_dir != prev->page_dir) vm_activate(next);
+    switch_context(&prev->esp, next->esp);
+    return 1;
+}
+
+int sleepers = 0; // Threads in sched_sleep()
+
+// Nothing else can run: wait for an interrupt to make someone ready.
+// Returns 0 if nobody is sleeping, since then nothing ever will.
+int sched_idle() {
+    if (sleepers == 0) return 0;
+    __asm__ volatile("sti; hlt; cli");
+    return 1;
+}
+
+// Sleep until someone calls wake() on us. Returns 0 (without blocking) if
+// nobody could ever wake us.
+int block_current() {
+    current->state = BLOCKED;
+    while (current->state == BLOCKED) {
+        if (schedule()) return 1;
+        if (!sched_idle()) {
+            current->state = RUNNING;
+            return 0;
+        }
+    }
+    current->state = RUNNING; // Woken by an interrupt while idle
+    return 1;
+}
+
+void sleep_timeout(void* pid) {
+    wake((int)pid);
+}
+
+// Block the current thread for at least ms milliseconds
+void sched_sleep(u32 ms) {
+    ktimer_t t;
+    timer_init(&t, sleep_timeout, (void*)current->pid);
+    timer_add(&system_timers, &t, ms_to_ticks(ms));
+    sleepers++;
+    while (timer_pending(&t)) {
+        if (!block_current()) break;
+    }
+    sleepers--;
+    timer_cancel(&t);
+}
+
+void wake(int pid) {
+    Process* p = find_process(pid);
+    if (p && p->state == BLOCKED) {
+        p->state = READY;
+        runq_push(pid);
+    }
+}
+
+void thread_exit() {
+    __asm__ volatile("cli");
+    current->state = TERMINATED;
+    // The stack goes back to the free list, but nothing can allocate it
+    // before we have switched away
+    proc_release_memory(current);
+    schedule();
+    while (1) __asm__ volatile("hlt"); // Nothing left to run
+}
+
+// Run other threads until pid exits, then reap it. Returns 0 if pid can
+// no longer make progress (it has no code, or everything is blocked).
+int sched_join(int pid) {
+    Process* p = find_process(pid);
+    if (!p) {
+        kprint("Error: No such process.\n");
+        return 0;
+    }
+    while (p->state != TERMINATED) {
+        if (!schedule() && !sched_idle()) {
+            kprint("Error: Process still running.\n");
+            return 0;
+        }
+    }
+    return wait_process(pid);
+}
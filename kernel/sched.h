@@ -0,0 +1,21 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "process.h"
+
+#define THREAD_STACK_SIZE 8192
+#define RUNQ_SIZE 4096      // Power of two
+#define THREAD_EFLAGS 0x002 // Interrupts off: threads are cooperative
+
+extern Process* current;
+
+void init_scheduler();
+int create_thread(char* name, thread_entry_t entry, void* arg);
+int schedule();
+int block_current();
+void wake(int pid);
+void thread_exit();
+void sched_sleep(u32 ms);
+int sched_join(int pid);
+
+#endif
@@ -0,0 +1,138 @@
+#include "search.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+// grep and find over the whole file table. Without the index every file is
+// scanned with mem_find(); with it, only files whose trigram bits match
+// the pattern are.
+
+int index_enabled = 0;
+u32 trigram_index[TRIGRAM_BUCKETS][INDEX_WORDS];
+
+u32 trigram_hash(char* p) {
+    u32 t = ((u8)p[0] << 16) | ((u8)p[1] << 8) | (u8)p[2];
+    return (t * 2654435761u) >> (32 - TRIGRAM_BITS);
+}
+
+void index_set(int slot, int on) {
+    File* f = &file_system[slot];
+    u32 bit = 1u << (slot & 31);
+    char* data = fs_data(f);
+    int size = fs_data_size(f);
+    for (int i = 0; i + 3 <= size; i++) {
+        u32* word = &trigram_index[trigram_hash(data + i)][slot >> 5];
+        if (on) *word |= bit;
+        else *word &= ~bit;
+    }
+}
+
+// Called by fs.c after a file's contents appear or change
+void index_file_added(int slot) {
+    if (index_enabled && file_system[slot].type == FS_FILE) index_set(slot, 1);
+}
+
+// Called by fs.c before a file's contents change or it is deleted.
+// Clearing every bucket the contents hash to is exact: no other trigram
+// of this file can have put the bit anywhere else.
+void index_file_removed(int slot) {
+    if (index_enabled && file_system[slot].type == FS_FILE) index_set(slot, 0);
+}
+
+// Build the index from scratch, or drop it
+void index_enable(int on) {
+    memory_set((u8*)trigram_index, 0, sizeof(trigram_index));
+    index_enabled = on;
+    if (!on) return;
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (file_system[i].used) index_file_added(i);
+    }
+}
+
+// Candidate files for pattern: the AND of its trigrams' buckets
+void index_candidates(char* pattern, int len, u32* result) {
+    for (int w = 0; w < INDEX_WORDS; w++) result[w] = ~0u;
+    for (int i = 0; i + 3 <= len; i++) {
+        u32* bucket = trigram_index[trigram_hash(pattern + i)];
+        for (int w = 0; w < INDEX_WORDS; w++) result[w] &= bucket[w];
+    }
+}
+
+int in_dir(File* f, char* dir) {
+    return starts_with(f->name, dir);
+}
+
+// Print every line of f that contains pattern, as "path: line"
+void grep_print_lines(File* f, char* data, char* pattern, int len) {
+    char line[GREP_LINE];
+    int size = fs_data_size(f);
+    int pos = 0;
+    while (pos < size) {
+        int at = mem_find(data + pos, size - pos, pattern, len);
+        if (at < 0) return;
+        at += pos;
+        int start = at;
+        while (start > 0 && data[start - 1] != '\n') start--;
+        int end = at;
+        while (end < size && data[end] != '\n') end++;
+
+        int n = end - start < GREP_LINE - 1 ? end - start : GREP_LINE - 1;
+        memory_copy(data + start, line, n);
+        line[n] = '\0';
+        kprint(f->name);
+        kprint(": ");
+        kprint(line);
+        kprint("\n");
+        pos = end + 1;
+    }
+}
+
+int grep_file(int slot, char* pattern, int len, char* dir, int quiet) {
+    File* f = &file_system[slot];
+    if (!f->used || f->type != FS_FILE || !in_dir(f, dir)) return 0;
+    char* data = fs_data(f);
+    if (mem_find(data, fs_data_size(f), pattern, len) < 0) return 0;
+    if (!quiet) grep_print_lines(f, data, pattern, len);
+    return 1;
+}
+
+// Files under dir containing pattern. Returns how many matched; quiet
+// only counts them.
+int search_grep(char* pattern, char* dir, int quiet) {
+    int len = strlen(pattern);
+    int matches = 0;
+    simd_begin(); // Once for every mem_find() below
+    if (!index_enabled || len < 3) {
+        for (int i = 0; i < MAX_FILES; i++) matches += grep_file(i, pattern, len, dir, quiet);
+        simd_end();
+        return matches;
+    }
+
+    u32 candidates[INDEX_WORDS];
+    index_candidates(pattern, len, candidates);
+    for (int w = 0; w < INDEX_WORDS; w++) {
+        u32 bits = candidates[w];
+        while (bits) {
+            int slot = w * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            if (slot < MAX_FILES) matches += grep_file(slot, pattern, len, dir, quiet);
+        }
+    }
+    simd_end();
+    return matches;
+}
+
+// Entries under dir whose path contains text
+int search_find(char* text, char* dir) {
+    int len = strlen(text);
+    int matches = 0;
+    for (int i = 0; i < MAX_FILES; i++) {
+        File* f = &file_system[i];
+        if (!f->used || !in_dir(f, dir)) continue;
+        if (mem_find(f->name, strlen(f->name), text, len) < 0) continue;
+        kprint(f->type == FS_DIR ? "[DIR] " : "      ");
+        kprint(f->name);
+        kprint("\n");
+        matches++;
+    }
+    return matches;
+}
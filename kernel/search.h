@@ -0,0 +1,25 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "fs.h"
+
+// Optional trigram index over file contents. Every 3-byte sequence of a
+// file is hashed to one of TRIGRAM_BUCKETS buckets; each bucket has one
+// bit per file slot. A file can only contain a pattern if it has the bit
+// set in the bucket of every trigram of the pattern. Hash collisions only
+// add candidates, which the scan then rules out.
+#define TRIGRAM_BITS 12
+#define TRIGRAM_BUCKETS (1 << TRIGRAM_BITS)
+#define INDEX_WORDS ((MAX_FILES + 31) / 32)
+
+#define GREP_LINE 80 // Longest line printed per match
+
+extern int index_enabled;
+
+void index_enable(int on);
+void index_file_added(int slot);
+void index_file_removed(int slot);
+int search_grep(char* pattern, char* dir, int quiet);
+int search_find(char* text, char* dir);
+
+#endif
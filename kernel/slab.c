@@ -0,0 +1,42 @@
+#include "slab.h"
+#include "mem.h"
+
+void slab_init(slab_cache_t* cache, char* name, u32 obj_size) {
+    // Every object must be able to hold (and be aligned for) the free list link
+    if (obj_size < sizeof(void*)) obj_size = sizeof(void*);
+    cache->name = name;
+    cache->obj_size = (obj_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    cache->free_list = 0;
+    cache->in_use = 0;
+    cache->pages = 0;
+}
+
+// Take a new page and thread all of its objects onto the free list
+int slab_grow(slab_cache_t* cache) {
+    char* page = (char*)page_alloc();
+    if (!page) return 0;
+    cache->pages++;
+
+    u32 count = PAGE_SIZE / cache->obj_size;
+    for (u32 i = 0; i < count; i++) {
+        void** obj = (void**)(page + i * cache->obj_size);
+        *obj = cache->free_list;
+        cache->free_list = obj;
+    }
+    return 1;
+}
+
+// Returns 0 when out of memory
+void* slab_alloc(slab_cache_t* cache) {
+    if (!cache->free_list && !slab_grow(cache)) return 0;
+    void** obj = (void**)cache->free_list;
+    cache->free_list = *obj;
+    cache->in_use++;
+    return obj;
+}
+
+void slab_free(slab_cache_t* cache, void* obj) {
+    *(void**)obj = cache->free_list;
+    cache->free_list = obj;
+    cache->in_use--;
+}
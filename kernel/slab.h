@@ -0,0 +1,19 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "types.h"
+
+// Cache of fixed-size objects carved out of whole pages
+typedef struct {
+    char* name;
+    u32 obj_size;
+    void* free_list;  // Free objects, linked through their first word
+    u32 in_use;
+    u32 pages;
+} slab_cache_t;
+
+void slab_init(slab_cache_t* cache, char* name, u32 obj_size);
+void* slab_alloc(slab_cache_t* cache);
+void slab_free(slab_cache_t* cache, void* obj);
+
+#endif
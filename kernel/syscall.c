@@ -0,0 +1,191 @@
+#include "syscall.h"
+#include "sched.h"
+#include "process.h"
+#include "fs.h"
+#include "mem.h"
+#include "vm.h"
+#include "../cpu/idt.h"
+#include "../cpu/gdt.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+#include "../libc/syscall.h"
+
+// Kernel side of the system call layer. Ring-3 code enters through
+// sysenter when the CPU has it (syscall_fast), else through int 0x80;
+// both end up in syscall_dispatch() on the calling thread's kernel stack.
+
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+#define CPUID_SEP (1 << 11)
+
+void sysenter_entry();                    // cpu/syscall.asm
+void isr_syscall();
+void enter_user_mode(u32 eip, u32 esp);
+
+typedef u32 (*syscall_t)(u32 a1, u32 a2, u32 a3);
+
+int syscall_fast = 0;
+
+void write_msr(u32 msr, u32 value) {
+    __asm__ volatile("wrmsr" : : "c"(msr), "a"(value), "d"(0));
+}
+
+int cpu_has_sysenter() {
+    u32 eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return (edx & CPUID_SEP) != 0;
+}
+
+// --- Calls ---
+// Every pointer a program passes is checked against its address space
+// first (vm_user_range, vm_user_string): a bad one fails the call with -1
+// (0 for spawn and mmap) instead of reaching kernel memory.
+
+#define TEXT_MAX PAGE_SIZE // Longest string print and write accept
+
+int user_name(u32 name) { return vm_user_string(current, name, MAX_FILENAME); }
+int user_text(u32 text) { return vm_user_string(current, text, TEXT_MAX); }
+
+u32 sys_null_call(u32 a1, u32 a2, u32 a3) { return 0; }
+
+u32 sys_exit_call(u32 a1, u32 a2, u32 a3) {
+    thread_exit();
+    return 0;
+}
+
+u32 sys_print_call(u32 text, u32 a2, u32 a3) {
+    if (!user_text(text)) return -1;
+    kprint((char*)text);
+    return 0;
+}
+
+u32 sys_getpid_call(u32 a1, u32 a2, u32 a3) { return current->pid; }
+
+u32 sys_yield_call(u32 a1, u32 a2, u32 a3) {
+    schedule();
+    return 0;
+}
+
+// Kernel arenas are supervisor-only in a program's address space, so
+// programs get heap from their own (vm_malloc)
+u32 sys_malloc_call(u32 size, u32 a2, u32 a3) {
+    if (current->page_dir) return vm_malloc(current, size);
+    return (u32)proc_malloc(current, size);
+}
+
+u32 sys_spawn_call(u32 name, u32 a2, u32 a3) {
+    if (!user_name(name)) return 0;
+    return create_process((char*)name, 1024);
+}
+
+// kill_process would free the stack and address space we are running on
+u32 sys_kill_call(u32 pid, u32 a2, u32 a3) {
+    if (pid == (u32)current->pid) thread_exit();
+    return kill_process(pid) ? 0 : -1;
+}
+
+u32 sys_wait_call(u32 pid, u32 a2, u32 a3) { return sched_join(pid) ? 0 : -1; }
+
+u32 sys_create_call(u32 name, u32 a2, u32 a3) {
+    if (!user_name(name)) return -1;
+    return fs_create((char*)name) ? 0 : -1;
+}
+
+u32 sys_mkdir_call(u32 name, u32 a2, u32 a3) {
+    if (!user_name(name)) return -1;
+    return fs_mkdir((char*)name) ? 0 : -1;
+}
+
+u32 sys_write_call(u32 name, u32 text, u32 a3) {
+    if (!user_name(name) || !user_text(text)) return -1;
+    return fs_write((char*)name, (char*)text) ? 0 : -1;
+}
+
+u32 sys_read_call(u32 name, u32 buf, u32 size) {
+    if (!user_name(name) || !size || !vm_user_range(current, buf, size, 1)) return -1;
+    File* f = fs_find((char*)name);
+    if (!f || f->type == FS_DIR) return -1;
+    u32 n = fs_data_size(f);
+    if (n > size - 1) n = size - 1;
+    memory_copy(fs_data(f), (char*)buf, n);
+    ((char*)buf)[n] = '\0';
+    return n;
+}
+
+u32 sys_delete_call(u32 name, u32 a2, u32 a3) {
+    if (!user_name(name)) return -1;
+    fs_delete((char*)name);
+    return 0;
+}
+
+u32 sys_list_call(u32 a1, u32 a2, u32 a3) {
+    fs_list();
+    return 0;
+}
+
+u32 sys_chdir_call(u32 path, u32 a2, u32 a3) {
+    if (!user_name(path)) return -1;
+    return fs_cd((char*)path) ? 0 : -1;
+}
+
+u32 sys_mmap_call(u32 name, u32 flags, u32 a3) {
+    if (!user_name(name)) return 0;
+    File* f = fs_find((char*)name);
+    if (!f) return 0;
+    u32 vm_flags = 0;
+    if (flags & MMAP_WRITE) vm_flags |= VM_WRITE;
+    if (flags & MMAP_SHARED) vm_flags |= VM_SHARED;
+    return vm_mmap(current, f, vm_flags);
+}
+
+u32 sys_munmap_call(u32 addr, u32 a2, u32 a3) { return vm_munmap(current, addr) ? 0 : -1; }
+u32 sys_msync_call(u32 addr, u32 a2, u32 a3) { return vm_msync(current, addr) ? 0 : -1; }
+
+syscall_t syscall_table[SYS_COUNT] = {
+    sys_null_call, sys_exit_call, sys_print_call, sys_getpid_call,
+    sys_yield_call, sys_malloc_call, sys_spawn_call, sys_kill_call,
+    sys_wait_call, sys_create_call, sys_mkdir_call, sys_write_call,
+    sys_read_call, sys_delete_call, sys_list_call, sys_chdir_call,
+    sys_mmap_call, sys_munmap_call, sys_msync_call,
+};
+
+u32 syscall_dispatch(u32 num, u32 a1, u32 a2, u32 a3) {
+    if (num >= SYS_COUNT) return -1;
+    return syscall_table[num](a1, a2, a3);
+}
+
+// sysenter takes its code segment from the MSR and derives the rest:
+// ss = cs + 8, and sysexit uses cs + 16 and cs + 24 (RPL 3), which is the
+// layout of cpu/gdt.c. The MSR stack is only used for the first
+// instruction of sysenter_entry, which switches to tss.esp0.
+void init_syscalls() {
+    set_idt_gate_flags(0x80, (u32)isr_syscall, IDT_USER_GATE);
+    set_idt();
+    if (cpu_has_sysenter()) {
+        write_msr(MSR_SYSENTER_CS, KERNEL_CS);
+        write_msr(MSR_SYSENTER_ESP, tss.esp0);
+        write_msr(MSR_SYSENTER_EIP, (u32)sysenter_entry);
+        syscall_fast = 1;
+    }
+}
+
+// --- User threads ---
+
+// Runs in ring 0 on the new thread's kernel stack, then drops to ring 3.
+// enter_user_mode never returns, so once in ring 3 the whole kernel stack
+// is free for syscalls and interrupts (tss.esp0 is its top).
+void user_thread_start(void* arg) {
+    char* stack = (char*)proc_page_alloc(current); // One-page user stack
+    if (!stack) {
+        kprint("Error: No memory for user stack.\n");
+        return;
+    }
+    u32* sp = (u32*)(stack + PAGE_SIZE);
+    *--sp = (u32)user_exit; // Where the program "returns" to
+    enter_user_mode((u32)arg, (u32)sp);
+}
+
+int create_user_thread(char* name, user_entry_t entry) {
+    return create_thread(name, user_thread_start, (void*)entry);
+}
@@ -0,0 +1,41 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include "types.h"
+
+// System call numbers (eax). Arguments go in ebx, esi, edi.
+#define SYS_NULL      0  // Does nothing; for measuring entry/exit cost
+#define SYS_EXIT      1  // ()
+#define SYS_PRINT     2  // (text)
+#define SYS_GETPID    3  // ()
+#define SYS_YIELD     4  // ()
+#define SYS_MALLOC    5  // (bytes) -> pointer or 0
+#define SYS_SPAWN     6  // (name) -> pid of a new process, or 0
+#define SYS_KILL      7  // (pid)
+#define SYS_WAIT      8  // (pid)
+#define SYS_CREATE    9  // (name)
+#define SYS_MKDIR     10 // (name)
+#define SYS_WRITE     11 // (name, text)
+#define SYS_READ      12 // (name, buf, size) -> bytes read or -1
+#define SYS_DELETE    13 // (name)
+#define SYS_LIST      14 // ()
+#define SYS_CHDIR     15 // (path)
+#define SYS_MMAP      16 // (name, flags) -> address of the file's contents, or 0
+#define SYS_MUNMAP    17 // (address)
+#define SYS_MSYNC     18 // (address) -> 0, or -1 if the file could not be written
+#define SYS_COUNT     19
+
+// SYS_MMAP flags. A private writable mapping gets its own copy of a page
+// on the first write; a shared one writes to the file on SYS_MSYNC.
+#define MMAP_WRITE  0x1
+#define MMAP_SHARED 0x2
+
+typedef void (*user_entry_t)();
+
+extern int syscall_fast;
+
+void init_syscalls();
+u32 syscall_dispatch(u32 num, u32 a1, u32 a2, u32 a3);
+int create_user_thread(char* name, user_entry_t entry);
+
+#endif
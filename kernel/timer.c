@@ -0,0 +1,122 @@
+#include "timer.h"
+
+// Timing wheel (see timer.h). Callbacks run from timer_tick(), which for
+// system_timers means in the timer interrupt: keep them short.
+
+timer_wheel_t system_timers;
+
+void timer_wheel_init(timer_wheel_t* w) {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int i = 0; i < WHEEL_SIZE; i++) w->slots[level][i] = 0;
+    }
+    w->ticks = 0;
+    w->count = 0;
+}
+
+void timer_init(ktimer_t* t, timer_callback_t callback, void* arg) {
+    t->next = 0;
+    t->pprev = 0;
+    t->wheel = 0;
+    t->expires = 0;
+    t->period = 0;
+    t->callback = callback;
+    t->arg = arg;
+}
+
+// Link t into the slot for its expiry time: the lowest level whose range
+// covers the remaining delay
+void timer_queue(timer_wheel_t* w, ktimer_t* t) {
+    u32 delay = t->expires - w->ticks;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delay >= (1u << (WHEEL_BITS * (level + 1)))) level++;
+
+    ktimer_t** slot = &w->slots[level][(t->expires >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1)];
+    t->next = *slot;
+    if (t->next) t->next->pprev = &t->next;
+    t->pprev = slot;
+    *slot = t;
+}
+
+void timer_unlink(ktimer_t* t) {
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    t->next = 0;
+    t->pprev = 0;
+}
+
+// Fire once, delay ticks from now (at least 1). Re-adding a pending timer
+// moves it.
+void timer_add(timer_wheel_t* w, ktimer_t* t, u32 delay) {
+    if (t->pprev) timer_cancel(t);
+    if (delay == 0) delay = 1;
+    if (delay > TIMER_MAX_DELAY) delay = TIMER_MAX_DELAY;
+    t->wheel = w;
+    t->period = 0;
+    t->expires = w->ticks + delay;
+    timer_queue(w, t);
+    w->count++;
+}
+
+// Fire every period ticks until cancelled
+void timer_add_periodic(timer_wheel_t* w, ktimer_t* t, u32 period) {
+    timer_add(w, t, period);
+    t->period = t->expires - w->ticks;
+}
+
+// Returns 1 if the timer was pending
+int timer_cancel(ktimer_t* t) {
+    t->period = 0;
+    if (!t->pprev) return 0;
+    timer_unlink(t);
+    t->wheel->count--;
+    return 1;
+}
+
+int timer_pending(ktimer_t* t) {
+    return t->pprev != 0;
+}
+
+// Re-queue every timer of a higher-level slot; they land lower down
+void timer_cascade(timer_wheel_t* w, int level, int index) {
+    ktimer_t* t = w->slots[level][index];
+    w->slots[level][index] = 0;
+    while (t) {
+        ktimer_t* next = t->next;
+        timer_queue(w, t);
+        t = next;
+    }
+}
+
+// Advance one tick and run whatever expires
+void timer_tick(timer_wheel_t* w) {
+    w->ticks++;
+    int index = w->ticks & (WHEEL_SIZE - 1);
+    for (int level = 1; index == 0 && level < WHEEL_LEVELS; level++) {
+        index = (w->ticks >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1);
+        timer_cascade(w, level, index);
+    }
+
+    // Detach the slot first: callbacks may add or cancel timers, this one
+    // included
+    ktimer_t* expired = w->slots[0][w->ticks & (WHEEL_SIZE - 1)];
+    w->slots[0][w->ticks & (WHEEL_SIZE - 1)] = 0;
+    if (expired) expired->pprev = &expired;
+    while (expired) {
+        ktimer_t* t = expired;
+        timer_unlink(t);
+        if (t->period) {
+            t->expires = w->ticks + t->period;
+            timer_queue(w, t);
+        } else {
+            w->count--;
+        }
+        t->callback(t->arg);
+    }
+}
+
+// Rounded up, and clamped like timer_add(); whole seconds are converted
+// separately so that ms * TIMER_HZ cannot overflow
+u32 ms_to_ticks(u32 ms) {
+    u32 ticks = ms / 1000 * TIMER_HZ + (ms % 1000 * TIMER_HZ + 999) / 1000;
+    return ticks > TIMER_MAX_DELAY ? TIMER_MAX_DELAY : ticks;
+}
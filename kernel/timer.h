@@ -0,0 +1,48 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+
+#define TIMER_HZ 100 // Ticks per second
+
+// Hierarchical timing wheel: WHEEL_LEVELS levels of WHEEL_SIZE slots.
+// Level 0 holds timers due in the next 64 ticks, level 1 the next 64*64,
+// and so on; a higher-level slot is moved down ("cascaded") when the
+// level below wraps. Insert and cancel are O(1).
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+#define TIMER_MAX_DELAY ((1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1) // ~46 h
+
+typedef void (*timer_callback_t)(void* arg);
+
+// Owned by the caller (usually embedded in a bigger struct or on the
+// stack); the wheel only links it in while it is pending
+typedef struct ktimer {
+    struct ktimer* next;
+    struct ktimer** pprev;   // 0 when not pending
+    struct timer_wheel* wheel;
+    u32 expires;             // Tick it fires at
+    u32 period;              // Re-armed with this delay if non-zero
+    timer_callback_t callback;
+    void* arg;
+} ktimer_t;
+
+typedef struct timer_wheel {
+    ktimer_t* slots[WHEEL_LEVELS][WHEEL_SIZE];
+    u32 ticks;
+    u32 count;               // Pending timers
+} timer_wheel_t;
+
+extern timer_wheel_t system_timers; // Driven by the PIT
+
+void timer_wheel_init(timer_wheel_t* w);
+void timer_init(ktimer_t* t, timer_callback_t callback, void* arg);
+void timer_add(timer_wheel_t* w, ktimer_t* t, u32 delay);
+void timer_add_periodic(timer_wheel_t* w, ktimer_t* t, u32 period);
+int timer_cancel(ktimer_t* t);
+int timer_pending(ktimer_t* t);
+void timer_tick(timer_wheel_t* w);
+u32 ms_to_ticks(u32 ms);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+typedef unsigned long long u64;
 typedef unsigned int   u32;
 typedef int            s32;
 typedef unsigned short u16;
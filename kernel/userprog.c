@@ -0,0 +1,30 @@
+#include "userprog.h"
+#include "../libc/syscall.h"
+#include "../libc/string.h"
+
+// Exercise the FS and process calls from ring 3
+void user_demo() {
+    char num[12];
+    char buf[64];
+    u16 cs;
+    __asm__ volatile("mov %%cs, %0" : "=r"(cs));
+
+    sys_print("Hello from user mode. PID ");
+    int_to_ascii(sys_getpid(), num);
+    sys_print(num);
+    sys_print(", CPL ");
+    int_to_ascii(cs & 3, num);
+    sys_print(num);
+    sys_print("\n");
+
+    if (sys_create("user.txt") == 0 && sys_write("user.txt", "Written from ring 3") == 0
+        && sys_read("user.txt", buf, sizeof(buf)) >= 0) {
+        sys_print("Read back: ");
+        sys_print(buf);
+        sys_print("\n");
+        sys_delete("user.txt");
+    }
+
+    int pid = sys_spawn("UserChild");
+    if (pid && sys_kill(pid) == 0 && sys_wait(pid) == 0) sys_print("Spawned, killed and reaped a child.\n");
+}
@@ -0,0 +1,9 @@
+#ifndef USERPROG_H
+#define USERPROG_H
+
+// Built-in programs that run in ring 3 and talk to the kernel only
+// through system calls (libc/syscall.h)
+
+void user_demo();
+
+#endif
@@ -0,0 +1,523 @@
+#include "vm.h"
+#include "mem.h"
+#include "slab.h"
+#include "sched.h"
+#include "../cpu/idt.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+// Paging and demand-paged user address spaces. The kernel keeps running
+// identity mapped (4 MiB pages below USER_BASE); each program gets its
+// own page directory whose user half starts empty. Pages are filled in by
+// the page fault handler on first touch: from the program file, or zeroed.
+// File pages come from a shared page cache, so program text is shared by
+// every instance and every mapping of a file (vm_mmap) sees the same
+// pages. Private areas copy a page on their first write to it.
+
+#define KERNEL_PDES (USER_BASE >> 22)
+#define CPUID_PSE (1 << 3)
+#define CR0_WP  0x00010000 // Ring 0 honours read-only pages too
+#define CR0_PG  0x80000000
+#define CR4_PSE 0x00000010
+
+void isr_page_fault(); // cpu/interrupt.asm
+
+// A file page mapped by every process that uses it. Entries live only
+// while some process maps the page. Program pages are keyed by the user
+// address they are mapped at, mmap pages by file offset (always below
+// USER_BASE, so the two never collide). A file that is rewritten gets new
+// entries; whoever still maps the old ones keeps seeing the old contents.
+typedef struct shared_page {
+    File* file;
+    u32 version;   // Of the file when the page was filled
+    u32 key;
+    void* page;
+    int refs;
+    struct shared_page* next;
+} shared_page_t;
+
+u32* kernel_dir = 0;
+int paging_enabled = 0;
+u32 vm_faults = 0;
+shared_page_t* shared_pages = 0;
+slab_cache_t area_cache;
+slab_cache_t shared_cache;
+
+void load_page_directory(u32* dir) {
+    __asm__ volatile("mov %0, %%cr3" : : "r"(dir) : "memory");
+}
+
+int cpu_has_pse() {
+    u32 eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return (edx & CPUID_PSE) != 0;
+}
+
+// The kernel directory is also used by built-in ring-3 threads
+// (create_user_thread), which run kernel code, so it is user accessible.
+// Program directories map the same memory supervisor-only.
+void init_paging() {
+    slab_init(&area_cache, "vm_area", sizeof(vm_area_t));
+    slab_init(&shared_cache, "shared_page", sizeof(shared_page_t));
+    if (!cpu_has_pse()) {
+        kprint("Error: No 4 MiB page support, programs disabled.\n");
+        return;
+    }
+    kernel_dir = (u32*)page_alloc();
+    if (!kernel_dir) return;
+    for (u32 i = 0; i < 1024; i++) {
+        if (i < KERNEL_PDES) kernel_dir[i] = (i << 22) | PTE_PRESENT | PTE_WRITE | PTE_USER | PTE_LARGE;
+        else kernel_dir[i] = 0;
+    }
+    set_idt_gate(14, (u32)isr_page_fault);
+
+    u32 reg;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(reg));
+    __asm__ volatile("mov %0, %%cr4" : : "r"(reg | CR4_PSE));
+    load_page_directory(kernel_dir);
+    __asm__ volatile("mov %%cr0, %0" : "=r"(reg));
+    __asm__ volatile("mov %0, %%cr0" : : "r"(reg | CR0_PG | CR0_WP));
+    paging_enabled = 1;
+}
+
+// --- Address spaces ---
+
+int vm_create(Process* p) {
+    u32* dir = (u32*)proc_page_alloc(p);
+    if (!dir) return 0;
+    for (u32 i = 0; i < 1024; i++) {
+        if (i < KERNEL_PDES) dir[i] = (i << 22) | PTE_PRESENT | PTE_WRITE | PTE_LARGE;
+        else dir[i] = 0;
+    }
+    p->page_dir = dir;
+    p->areas = 0;
+    p->heap_next = 0;
+    return 1;
+}
+
+// Returns 0 if the range is not page aligned user space or overlaps an
+// existing area
+int vm_add_area(Process* p, u32 start, u32 end, u32 flags, File* file,
+                u32 data_start, u32 data_end, u32 file_offset) {
+    if ((start | end) & (PAGE_SIZE - 1)) return 0;
+    if (start < USER_BASE || end > USER_STACK_TOP || start >= end) return 0;
+    for (vm_area_t* a = p->areas; a; a = a->next) {
+        if (start < a->end && a->start < end) return 0;
+    }
+
+    vm_area_t* a = (vm_area_t*)slab_alloc(&area_cache);
+    if (!a) return 0;
+    a->start = start;
+    a->end = end;
+    a->flags = flags;
+    a->file = file;
+    a->generation = file ? file->generation : 0;
+    a->data_start = data_start;
+    a->data_end = data_end;
+    a->file_offset = file_offset;
+    a->next = p->areas;
+    p->areas = a;
+    return 1;
+}
+
+vm_area_t* vm_find_area(Process* p, u32 addr) {
+    for (vm_area_t* a = p->areas; a; a = a->next) {
+        if (addr >= a->start && addr < a->end) return a;
+    }
+    return 0;
+}
+
+// --- User pointers ---
+// System calls check what a program hands them before using it. Built-in
+// ring-3 threads have no address space of their own (they run kernel
+// code), so for them only null is refused.
+
+// [addr, addr + size) lies in p's areas, writable ones if write
+int vm_user_range(Process* p, u32 addr, u32 size, int write) {
+    if (!addr) return 0;
+    if (!p->page_dir) return 1;
+    if (addr < USER_BASE || addr + size < addr) return 0;
+    u32 end = addr + size;
+    do {
+        vm_area_t* a = vm_find_area(p, addr);
+        if (!a || (write && !(a->flags & VM_WRITE))) return 0;
+        addr = a->end;
+    } while (addr < end);
+    return 1;
+}
+
+// A string at addr ends within max bytes, all in p's areas. Reading it
+// faults its pages in like any other access.
+int vm_user_string(Process* p, u32 addr, u32 max) {
+    if (!addr) return 0;
+    if (!p->page_dir) return 1;
+    if (addr < USER_BASE) return 0;
+    while (max) {
+        vm_area_t* a = vm_find_area(p, addr);
+        if (!a) return 0;
+        u32 n = a->end - addr < max ? a->end - addr : max;
+        for (u32 i = 0; i < n; i++) {
+            if (!((char*)addr)[i]) return 1;
+        }
+        addr += n;
+        max -= n;
+    }
+    return 0;
+}
+
+// Switch to p's address space (the kernel's if it has none)
+void vm_activate(Process* p) {
+    if (!paging_enabled) return;
+    load_page_directory(p->page_dir ? p->page_dir : kernel_dir);
+}
+
+// --- Shared text pages ---
+
+void shared_page_put(void* page) {
+    shared_page_t** link = &shared_pages;
+    while (*link && (*link)->page != page) link = &(*link)->next;
+    if (!*link) return;
+
+    shared_page_t* s = *link;
+    if (--s->refs > 0) return;
+    *link = s->next;
+    page_free(s->page);
+    slab_free(&shared_cache, s);
+}
+
+int vm_msync_area(Process* p, vm_area_t* a); // File mappings, below
+
+// Unmap everything and drop the areas. The directory and page tables are
+// owned pages, freed with the rest of the process's memory. Shared file
+// mappings are written back first, as munmap does.
+void vm_destroy(Process* p) {
+    if (!p->page_dir) return;
+    for (vm_area_t* a = p->areas; a; a = a->next) {
+        if (a->flags & VM_MMAP) vm_msync_area(p, a);
+    }
+    if (p == current) load_page_directory(kernel_dir);
+
+    for (u32 i = KERNEL_PDES; i < 1024; i++) {
+        if (!(p->page_dir[i] & PTE_PRESENT)) continue;
+        u32* table = (u32*)(p->page_dir[i] & ~(PAGE_SIZE - 1));
+        for (u32 j = 0; j < 1024; j++) {
+            if ((table[j] & PTE_PRESENT) && (table[j] & PTE_SHARED)) {
+                shared_page_put((void*)(table[j] & ~(PAGE_SIZE - 1)));
+                p->pages--;
+            }
+        }
+    }
+
+    vm_area_t* a = p->areas;
+    while (a) {
+        vm_area_t* next = a->next;
+        slab_free(&area_cache, a);
+        a = next;
+    }
+    p->areas = 0;
+    p->page_dir = 0;
+}
+
+// --- Page faults ---
+
+// a is backed by a file that is still the one it was set up with (the
+// slot may since have been deleted and reused)
+int vm_file_ok(vm_area_t* a) {
+    return a->file && a->file->generation == a->generation;
+}
+
+// Contents of the page at addr: file bytes where the area has them,
+// zeros everywhere else
+void vm_fill(vm_area_t* a, u32 addr, char* page) {
+    memory_set((u8*)page, 0, PAGE_SIZE);
+    if (!vm_file_ok(a)) return;
+    // Never past what the file holds now: a program's file may have been
+    // rewritten shorter, or deleted, since the areas were set up
+    int size = fs_data_size(a->file);
+    u32 end = size > (int)a->file_offset ? a->data_start + (size - a->file_offset) : a->data_start;
+    u32 lo = addr > a->data_start ? addr : a->data_start;
+    u32 hi = addr + PAGE_SIZE < a->data_end ? addr + PAGE_SIZE : a->data_end;
+    if (hi > end) hi = end;
+    if (lo >= hi) return;
+    memory_copy(fs_data(a->file) + a->file_offset + (lo - a->data_start), page + (lo - addr), hi - lo);
+}
+
+u32 shared_page_key(vm_area_t* a, u32 addr) {
+    if (a->flags & VM_MMAP) return addr - a->start + a->file_offset;
+    return addr;
+}
+
+shared_page_t* shared_page_find(void* page) {
+    shared_page_t* s = shared_pages;
+    while (s && s->page != page) s = s->next;
+    return s;
+}
+
+void* shared_page_get(vm_area_t* a, u32 addr) {
+    u32 key = shared_page_key(a, addr);
+    for (shared_page_t* s = shared_pages; s; s = s->next) {
+        if (s->file == a->file && s->key == key && s->version == a->file->version) {
+            s->refs++;
+            return s->page;
+        }
+    }
+
+    shared_page_t* s = (shared_page_t*)slab_alloc(&shared_cache);
+    if (!s) return 0;
+    s->page = page_alloc();
+    if (!s->page) {
+        slab_free(&shared_cache, s);
+        return 0;
+    }
+    vm_fill(a, addr, (char*)s->page);
+    s->file = a->file;
+    s->version = a->file->version;
+    s->key = key;
+    s->refs = 1;
+    s->next = shared_pages;
+    shared_pages = s;
+    return s->page;
+}
+
+// p's page table entry for the user address addr, 0 if it has no page
+// table there
+u32* vm_pte(Process* p, u32 addr) {
+    u32 pde = p->page_dir[addr >> 22];
+    if (!(pde & PTE_PRESENT)) return 0;
+    return (u32*)(pde & ~(PAGE_SIZE - 1)) + ((addr >> 12) & 0x3FF);
+}
+
+int vm_map(Process* p, u32 addr, void* page, u32 flags) {
+    u32* pde = &p->page_dir[addr >> 22];
+    if (!(*pde & PTE_PRESENT)) {
+        u32* table = (u32*)proc_page_alloc(p);
+        if (!table) return 0;
+        memory_set((u8*)table, 0, PAGE_SIZE);
+        *pde = (u32)table | PTE_PRESENT | PTE_WRITE | PTE_USER;
+    }
+    u32* table = (u32*)(*pde & ~(PAGE_SIZE - 1));
+    table[(addr >> 12) & 0x3FF] = (u32)page | flags;
+    __asm__ volatile("invlpg (%0)" : : "r"(addr) : "memory");
+    return 1;
+}
+
+// Bad user access, from the program itself or from a system call on its
+// behalf: the process dies. Anything else is a kernel bug.
+void vm_bad_access(u32 addr, u32 error, char* what) {
+    char hex[12];
+    hex_to_ascii(addr, hex);
+    if ((error & PF_USER) || addr >= USER_BASE) {
+        kprint(what);
+        kprint(" at ");
+        kprint(hex);
+        kprint(", process killed.\n");
+        thread_exit();
+    }
+    kprint("Kernel page fault at ");
+    kprint(hex);
+    kprint("\n");
+    while (1) __asm__ volatile("cli; hlt");
+}
+
+// First write to a page that a private area still shares with the cache:
+// give the process its own copy
+void vm_copy_on_write(Process* p, u32 addr, u32 error) {
+    u32* pte = vm_pte(p, addr);
+    if (!pte || !(*pte & PTE_SHARED)) vm_bad_access(addr, error, "Segmentation fault");
+    void* shared = (void*)(*pte & ~(PAGE_SIZE - 1));
+    p->pages--; // The copy replaces the shared page in the resident size
+    void* page = proc_page_alloc(p);
+    if (!page) {
+        p->pages++;
+        vm_bad_access(addr, error, "Out of memory");
+    }
+    memory_copy((char*)shared, (char*)page, PAGE_SIZE);
+    vm_map(p, addr, page, PTE_PRESENT | PTE_USER | PTE_WRITE); // Has a table already
+    shared_page_put(shared);
+}
+
+void page_fault_handler(u32 addr, u32 error) {
+    vm_faults++;
+    Process* p = current;
+    vm_area_t* a = p->page_dir ? vm_find_area(p, addr) : 0;
+    if (!a || ((error & PF_WRITE) && !(a->flags & VM_WRITE))
+        || ((error & PF_PRESENT) && !(error & PF_WRITE))) {
+        vm_bad_access(addr, error, "Segmentation fault");
+    }
+
+    u32 page_addr = addr & ~(PAGE_SIZE - 1);
+    if (error & PF_PRESENT) {
+        vm_copy_on_write(p, page_addr, error);
+        return;
+    }
+
+    // File pages come from the cache, except where a private area writes
+    // straight away. An area whose file is gone reads zeros.
+    void* page;
+    u32 flags = PTE_PRESENT | PTE_USER;
+    if (vm_file_ok(a) && (!(a->flags & VM_WRITE) || (a->flags & VM_SHARED) || !(error & PF_WRITE))) {
+        page = shared_page_get(a, page_addr);
+        flags |= PTE_SHARED;
+        if ((a->flags & VM_SHARED) && (a->flags & VM_WRITE)) flags |= PTE_WRITE;
+        if (page) {
+            p->pages++; // Counted in every sharer's resident size
+            if (p->pages > p->peak_pages) p->peak_pages = p->pages;
+        }
+    } else {
+        page = proc_page_alloc(p);
+        if (page) vm_fill(a, page_addr, (char*)page);
+        if (a->flags & VM_WRITE) flags |= PTE_WRITE;
+    }
+
+    if (!page) vm_bad_access(addr, error, "Out of memory");
+    if (!vm_map(p, page_addr, page, flags)) {
+        if (flags & PTE_SHARED) {
+            shared_page_put(page);
+            p->pages--;
+        }
+        vm_bad_access(addr, error, "Out of memory");
+    }
+}
+
+// --- Heap ---
+
+// Heap memory for a program, which cannot use the kernel's arenas
+// (proc_malloc): a zero-filled area just above its segments, bump
+// allocated the same way and grown as needed. Its pages are only
+// allocated when touched. Returns the address, or 0.
+u32 vm_heap_alloc(Process* p, u32 size) {
+    size = (size + PROC_HEAP_ALIGN - 1) & ~(PROC_HEAP_ALIGN - 1);
+    if (size == 0 || size > PAGE_SIZE || !p->page_dir) return 0;
+    vm_area_t* heap = 0;
+    u32 top = USER_BASE;
+    for (vm_area_t* a = p->areas; a; a = a->next) {
+        if (a->flags & VM_HEAP) heap = a;
+        else if (a->end <= MMAP_BASE && a->end > top) top = a->end;
+    }
+    if (!heap) {
+        if (!vm_add_area(p, top, top + PAGE_SIZE, VM_WRITE | VM_HEAP, 0, 0, 0, 0)) return 0;
+        heap = p->areas;
+        p->heap_next = top;
+    }
+
+    u32 end = p->heap_next + size;
+    if (end > heap->end) {
+        // Grow into free address space, within the memory limit
+        u32 grown = PAGE_ALIGN_UP(end);
+        if (grown > MMAP_BASE || p->pages + (grown - heap->end) / PAGE_SIZE > p->mem_limit) return 0;
+        for (vm_area_t* a = p->areas; a; a = a->next) {
+            if (a != heap && a->start < grown && heap->end < a->end) return 0;
+        }
+        heap->end = grown;
+    }
+    u32 block = p->heap_next;
+    p->heap_next = end;
+    return block;
+}
+
+u32 vm_malloc(Process* p, u32 size) {
+    u32 block = vm_heap_alloc(p, size);
+    if (block) p->alloc_count++;
+    else p->failed_allocs++;
+    return block;
+}
+
+// --- File mappings ---
+
+char msync_buf[MAX_FILESIZE + 1];
+
+// Map f at the lowest free address from MMAP_BASE up. flags: VM_WRITE,
+// VM_SHARED (else writes stay private to p). A file never outgrows its
+// slot, so every mapping covers MAX_FILESIZE bytes; past the end of the
+// file it reads as zeros. Returns the address, or 0.
+u32 vm_mmap(Process* p, File* f, u32 flags) {
+    if (!p->page_dir || !f->used || f->type != FS_FILE) return 0;
+    u32 len = PAGE_ALIGN_UP(MAX_FILESIZE);
+    u32 addr = MMAP_BASE;
+    vm_area_t* a = p->areas;
+    while (a) {
+        if (addr < a->end && a->start < addr + len) {
+            addr = a->end; // Past it, then check every area again
+            a = p->areas;
+        } else {
+            a = a->next;
+        }
+    }
+    if (addr + len > USER_STACK_TOP - USER_STACK_SIZE) return 0;
+    flags = (flags & (VM_WRITE | VM_SHARED)) | VM_MMAP;
+    if (!vm_add_area(p, addr, addr + len, flags, f, addr, addr + len, 0)) return 0;
+    return addr;
+}
+
+vm_area_t* vm_find_mapping(Process* p, u32 addr) {
+    vm_area_t* a = p->page_dir ? vm_find_area(p, addr) : 0;
+    return a && (a->flags & VM_MMAP) ? a : 0;
+}
+
+// Put the pages of a shared, writable mapping that it wrote to into the
+// file. The pages then are the cache's copy of the new contents. Only
+// p's own writes count (its dirty bits): another process writing to the
+// same pages has them written back by its own msync, munmap or exit.
+// Returns 0 if the file is gone or could not be stored.
+int vm_msync_area(Process* p, vm_area_t* a) {
+    File* f = a->file;
+    if (!(a->flags & VM_SHARED) || !(a->flags & VM_WRITE)) return 1;
+    if (!vm_file_ok(a) || !f->used || f->type != FS_FILE) return 0;
+
+    int dirty = 0;
+    u32 size = fs_load(f, msync_buf);
+    for (u32 addr = a->start; addr < a->end; addr += PAGE_SIZE) {
+        u32* pte = vm_pte(p, addr);
+        u32 offset = addr - a->start + a->file_offset;
+        if (!pte || !(*pte & PTE_PRESENT) || !(*pte & PTE_DIRTY)) continue;
+        dirty = 1;
+        if (offset >= size) continue; // Beyond the end: not part of the file
+        u32 n = size - offset < PAGE_SIZE ? size - offset : PAGE_SIZE;
+        memory_copy((char*)(*pte & ~(PAGE_SIZE - 1)), msync_buf + offset, n);
+    }
+    if (!dirty) return 1;
+    if (!fs_write_file(f, msync_buf, size)) return 0;
+
+    for (u32 addr = a->start; addr < a->end; addr += PAGE_SIZE) {
+        u32* pte = vm_pte(p, addr);
+        if (!pte || !(*pte & PTE_PRESENT)) continue;
+        shared_page_t* s = shared_page_find((void*)(*pte & ~(PAGE_SIZE - 1)));
+        if (s) s->version = f->version;
+        *pte &= ~PTE_DIRTY;
+        __asm__ volatile("invlpg (%0)" : : "r"(addr) : "memory");
+    }
+    return 1;
+}
+
+int vm_msync(Process* p, u32 addr) {
+    vm_area_t* a = vm_find_mapping(p, addr);
+    return a && vm_msync_area(p, a);
+}
+
+// Remove the mapping that contains addr, writing shared changes back
+// first. Private copies are freed, cached pages released.
+int vm_munmap(Process* p, u32 addr) {
+    vm_area_t* a = vm_find_mapping(p, addr);
+    if (!a) return 0;
+    vm_msync_area(p, a);
+
+    for (u32 va = a->start; va < a->end; va += PAGE_SIZE) {
+        u32* pte = vm_pte(p, va);
+        if (!pte || !(*pte & PTE_PRESENT)) continue;
+        void* page = (void*)(*pte & ~(PAGE_SIZE - 1));
+        if (*pte & PTE_SHARED) {
+            shared_page_put(page);
+            p->pages--;
+        } else {
+            proc_page_free(p, page);
+        }
+        *pte = 0;
+        __asm__ volatile("invlpg (%0)" : : "r"(va) : "memory");
+    }
+
+    vm_area_t** link = &p->areas;
+    while (*link != a) link = &(*link)->next;
+    *link = a->next;
+    slab_free(&area_cache, a);
+    return 1;
+}
@@ -0,0 +1,67 @@
+#ifndef VM_H
+#define VM_H
+
+#include "types.h"
+#include "process.h"
+#include "fs.h"
+
+// Address space: the first 1 GiB is the kernel, identity mapped with
+// 4 MiB pages in every page directory. User programs live above it.
+#define USER_BASE       0x40000000
+#define USER_STACK_TOP  0xC0000000
+#define USER_STACK_SIZE (64 * 1024)
+#define MMAP_BASE       0x80000000 // File mappings go between here and the stack
+
+// Page table entry bits
+#define PTE_PRESENT 0x001
+#define PTE_WRITE   0x002
+#define PTE_USER    0x004
+#define PTE_DIRTY   0x040 // Set by the CPU on a write
+#define PTE_LARGE   0x080 // 4 MiB page (page directory entries only)
+#define PTE_SHARED  0x200 // Ours (an "available" bit): page is in the shared cache
+
+// Page fault error code bits
+#define PF_PRESENT 0x1 // Protection violation (else: page not present)
+#define PF_WRITE   0x2
+#define PF_USER    0x4
+
+// Area flags
+#define VM_WRITE  0x1
+#define VM_SHARED 0x2 // Writes go to the shared page (and to the file on msync)
+#define VM_MMAP   0x4 // A file mapping (vm_mmap), else a program segment
+#define VM_HEAP   0x8 // The program heap (vm_malloc), grows up
+
+// A range of user addresses and where its pages come from. Pages are
+// only allocated when first touched (see page_fault_handler). File pages
+// are read from the shared page cache; a private area gets its own copy
+// of a page when it first writes to it.
+typedef struct vm_area {
+    u32 start;          // Page aligned
+    u32 end;
+    u32 flags;
+    File* file;         // 0: zero-filled (bss, stack)
+    u32 generation;     // Of file when the area was set up
+    u32 data_start;     // [data_start, data_end) is backed by the file,
+    u32 data_end;       // starting at file_offset; the rest is zero
+    u32 file_offset;
+    struct vm_area* next;
+} vm_area_t;
+
+extern int paging_enabled;
+extern u32 vm_faults;
+
+void init_paging();
+int vm_create(Process* p);
+int vm_add_area(Process* p, u32 start, u32 end, u32 flags, File* file,
+                u32 data_start, u32 data_end, u32 file_offset);
+int vm_user_range(Process* p, u32 addr, u32 size, int write);
+int vm_user_string(Process* p, u32 addr, u32 max);
+void vm_activate(Process* p);
+void vm_destroy(Process* p);
+void page_fault_handler(u32 addr, u32 error);
+u32 vm_malloc(Process* p, u32 size);
+u32 vm_mmap(Process* p, File* f, u32 flags);
+int vm_munmap(Process* p, u32 addr);
+int vm_msync(Process* p, u32 addr);
+
+#endif
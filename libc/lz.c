@@ -0,0 +1,129 @@
+#include "lz.h"
+#include "string.h"
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_SKIP_TRIGGER 5 // Misses before the scan starts taking bigger steps
+
+// Last position of every hashed 4-byte sequence, plus lz_base. Each call
+// raises lz_base past every position of the one before, which makes all
+// old entries stale without clearing the table.
+u32 lz_table[1 << LZ_HASH_BITS];
+u32 lz_base = 0;
+
+u32 lz_read32(u8* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+// Extra length bytes for a count that did not fit in its nibble. Returns
+// the new output position, or -1 if out of room.
+int lz_put_length(u8* out, int op, int cap, int n) {
+    while (n >= 255) {
+        if (op >= cap) return -1;
+        out[op++] = 255;
+        n -= 255;
+    }
+    if (op >= cap) return -1;
+    out[op++] = n;
+    return op;
+}
+
+// One sequence: nlit literals, then a match of mlen bytes offset back
+// (mlen 0 for the closing literals-only sequence)
+int lz_put_sequence(u8* out, int op, int cap, u8* lit, int nlit, int offset, int mlen) {
+    int m = mlen ? mlen - LZ_MIN_MATCH : 0;
+    if (op >= cap) return -1;
+    out[op++] = ((nlit < 15 ? nlit : 15) << 4) | (m < 15 ? m : 15);
+    if (nlit >= 15 && (op = lz_put_length(out, op, cap, nlit - 15)) < 0) return -1;
+    if (nlit > cap - op) return -1;
+    memory_copy((char*)lit, (char*)out + op, nlit);
+    op += nlit;
+    if (!mlen) return op;
+
+    if (cap - op < 2) return -1;
+    out[op++] = offset & 0xFF;
+    out[op++] = offset >> 8;
+    if (m >= 15 && (op = lz_put_length(out, op, cap, m - 15)) < 0) return -1;
+    return op;
+}
+
+int lz_compress(char* src, int len, char* dst, int cap) {
+    u8* in = (u8*)src;
+    u8* out = (u8*)dst;
+    if (len < 0 || len > LZ_MAX_INPUT) return 0;
+    if (lz_base > 0xFFFFFFFFu - 2 * (LZ_MAX_INPUT + 1)) {
+        memory_set((u8*)lz_table, 0, sizeof(lz_table));
+        lz_base = 0;
+    }
+    lz_base += LZ_MAX_INPUT + 1;
+
+    int ip = 0, anchor = 0, op = 0;
+    int misses = 0;
+    while (ip + LZ_MIN_MATCH <= len) {
+        u32 seq = lz_read32(in + ip);
+        u32 h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        u32 entry = lz_table[h];
+        lz_table[h] = lz_base + ip;
+        int ref = (int)(entry - lz_base);
+        if (entry < lz_base || lz_read32(in + ref) != seq) {
+            // Incompressible stretches are skipped faster and faster
+            ip += 1 + (misses++ >> LZ_SKIP_TRIGGER);
+            continue;
+        }
+        misses = 0;
+
+        int mlen = LZ_MIN_MATCH;
+        while (ip + mlen < len && in[ref + mlen] == in[ip + mlen]) mlen++;
+        op = lz_put_sequence(out, op, cap, in + anchor, ip - anchor, ip - ref, mlen);
+        if (op < 0) return 0;
+        ip += mlen;
+        anchor = ip;
+    }
+    op = lz_put_sequence(out, op, cap, in + anchor, len - anchor, 0, 0);
+    return op < 0 ? 0 : op;
+}
+
+// Continuation bytes of a length. Returns -1 if they run off the input.
+int lz_get_length(u8* in, int len, int* ip) {
+    int n = 0;
+    for (;;) {
+        if (*ip >= len || n > LZ_MAX_INPUT) return -1;
+        u8 b = in[(*ip)++];
+        n += b;
+        if (b != 255) return n;
+    }
+}
+
+int lz_decompress(char* src, int len, char* dst, int cap) {
+    u8* in = (u8*)src;
+    u8* out = (u8*)dst;
+    int ip = 0, op = 0;
+    while (ip < len) {
+        int token = in[ip++];
+        int n = token >> 4;
+        if (n == 15) {
+            int extra = lz_get_length(in, len, &ip);
+            if (extra < 0) return -1;
+            n += extra;
+        }
+        if (n > len - ip || n > cap - op) return -1;
+        memory_copy((char*)in + ip, (char*)out + op, n);
+        ip += n;
+        op += n;
+        if (ip == len) return op; // Closing sequence
+
+        if (len - ip < 2) return -1;
+        int offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        int m = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15) {
+            int extra = lz_get_length(in, len, &ip);
+            if (extra < 0) return -1;
+            m += extra;
+        }
+        if (offset == 0 || offset > op || m > cap - op) return -1;
+        // Byte by byte: the match may overlap what it produces
+        for (int i = 0; i < m; i++, op++) out[op] = out[op - offset];
+    }
+    return -1;
+}
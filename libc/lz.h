@@ -0,0 +1,19 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include "../kernel/types.h"
+
+// Byte-oriented LZ77 codec in the LZ4 block format: a token byte (literal
+// count, match length - 4), the literals, a 2-byte match offset, and
+// 255-continued extra length bytes when a count does not fit in 4 bits.
+// The last sequence has literals only.
+
+#define LZ_MAX_INPUT 65535
+
+// Returns the compressed size, or 0 if it would not fit in cap bytes
+int lz_compress(char* src, int len, char* dst, int cap);
+// Returns the decompressed size, or -1 if src is corrupt or the result
+// would not fit in cap bytes
+int lz_decompress(char* src, int len, char* dst, int cap);
+
+#endif
@@ -33,6 +33,52 @@ void int_to_ascii(int n, char str[]) {
     reverse(str);
 }
 
+// Parses a decimal number (e.g., "123" -> 123). Returns -1 if s is not one.
+int ascii_to_int(char s[]) {
+    int n = 0;
+    if (s[0] == '\0') return -1;
+    for (int i = 0; s[i] != '\0'; i++) {
+        if (s[i] < '0' || s[i] > '9') return -1;
+        n = n * 10 + (s[i] - '0');
+    }
+    return n;
+}
+
+// Same for unsigned values (cycle counts, addresses...)
+void uint_to_ascii(u32 n, char str[]) {
+    int i = 0;
+    do {
+        str[i++] = n % 10 + '0';
+    } while ((n /= 10) > 0);
+    str[i] = '\0';
+
+    reverse(str);
+}
+
+// Converts a number to 8 hex digits (e.g., 0xb8000 -> "0x000B8000")
+void hex_to_ascii(u32 n, char str[]) {
+    char digits[] = "0123456789ABCDEF";
+    str[0] = '0';
+    str[1] = 'x';
+    for (int i = 0; i < 8; i++) {
+        str[9 - i] = digits[n & 0xF];
+        n >>= 4;
+    }
+    str[10] = '\0';
+}
+
+// Copy nbytes from source to dest (regions must not overlap)
+void memory_copy(char *source, char *dest, int nbytes) {
+    int i;
+    for (i = 0; i < nbytes; i++) {
+        *(dest + i) = *(source + i);
+    }
+}
+
+void memory_set(u8* dest, u8 val, u32 len) {
+    for (u32 i = 0; i < len; i++) dest[i] = val;
+}
+
 // Adds a character to the end of a string
 void append(char s[], char n) {
     int len = strlen(s);
@@ -138,4 +184,93 @@ int starts_with(char* str, char* prefix) {
         i++;
     }
     return 1;
+}
+
+// Index of the first occurrence of needle in haystack, or -1
+int str_find(char* haystack, char* needle) {
+    return mem_find(haystack, strlen(haystack), needle, strlen(needle));
+}
+
+// --- Substring search over raw bytes ---
+
+int sse2_enabled = 0; // Set once the kernel has turned SSE on (cpu/simd.c)
+
+typedef char v16 __attribute__((vector_size(16)));
+typedef char v16_unaligned __attribute__((vector_size(16), aligned(1)));
+
+int mem_equal(char* a, char* b, int len) {
+    for (int i = 0; i < len; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+// Test 16 candidate positions at a time: compare each against the
+// needle's first byte (pcmpeqb), turn the result into a bit mask
+// (pmovmskb) and only verify the positions whose bit is set
+__attribute__((target("sse2")))
+int mem_find_sse2(char* hay, int last, char* needle, int nlen) {
+    v16 first = (v16){0} + needle[0];
+    int i = 0;
+    for (; i + 15 <= last; i += 16) {
+        v16 block = *(v16_unaligned*)(hay + i);
+        int mask = __builtin_ia32_pmovmskb128(block == first);
+        while (mask) {
+            int pos = i + __builtin_ctz(mask);
+            if (mem_equal(hay + pos + 1, needle + 1, nlen - 1)) return pos;
+            mask &= mask - 1;
+        }
+    }
+    for (; i <= last; i++) {
+        if (hay[i] == needle[0] && mem_equal(hay + i + 1, needle + 1, nlen - 1)) return i;
+    }
+    return -1;
+}
+
+// Offset of the first needle in hay[0..len), or -1
+int mem_find(char* hay, int len, char* needle, int nlen) {
+    if (nlen == 0) return 0;
+    int last = len - nlen; // Last possible start
+    if (last < 0) return -1;
+    if (sse2_enabled) {
+        simd_begin();
+        int at = mem_find_sse2(hay, last, needle, nlen);
+        simd_end();
+        return at;
+    }
+    for (int i = 0; i <= last; i++) {
+        if (hay[i] == needle[0] && mem_equal(hay + i + 1, needle + 1, nlen - 1)) return i;
+    }
+    return -1;
+}
+
+// Copy at most size-1 characters of src; dest is always terminated
+void strlcpy(char* dest, char* src, int size) {
+    int i = 0;
+    while (src[i] != '\0' && i < size - 1) {
+        dest[i] = src[i];
+        i++;
+    }
+    dest[i] = '\0';
+}
+
+// Split "cmd arg1 arg2..." into arg1 and the rest of the line in arg2.
+// Both buffers hold size bytes; longer arguments are truncated.
+void get_args(char* input, char* arg1, char* arg2, int size) {
+    int i = 0;
+    while(input[i] != ' ' && input[i] != '\0') i++;
+    if (input[i] == ' ') i++;
+    int j = 0;
+    while(input[i] != ' ' && input[i] != '\0') {
+        if (j < size - 1) arg1[j++] = input[i];
+        i++;
+    }
+    arg1[j] = '\0';
+    if (input[i] == ' ') i++;
+    j = 0;
+    while(input[i] != '\0') {
+        if (j < size - 1) arg2[j++] = input[i];
+        i++;
+    }
+    arg2[j] = '\0';
 }
\ No newline at end of file
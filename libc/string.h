@@ -1,7 +1,14 @@
 #ifndef STRING_H
 #define STRING_H
 
+#include "../kernel/types.h"
+
 void int_to_ascii(int n, char str[]);
+void uint_to_ascii(u32 n, char str[]);
+int ascii_to_int(char s[]);
+void memory_copy(char *source, char *dest, int nbytes);
+void memory_set(u8* dest, u8 val, u32 len);
+void hex_to_ascii(u32 n, char str[]);
 void reverse(char s[]);
 int strlen(char s[]);
 void backspace(char s[]);
@@ -14,4 +21,11 @@ int strcasecmp_prefix(char* s, char* prefix);
 void strcpy(char* dest, char* src);
 void strcat(char* dest, char* src);
 int starts_with(char* str, char* prefix);
+int str_find(char* haystack, char* needle);
+extern int sse2_enabled;
+void simd_begin(); // cpu/simd.c; stand-ins for user programs and the host
+void simd_end();
+int mem_find(char* hay, int len, char* needle, int nlen);
+void strlcpy(char* dest, char* src, int size);
+void get_args(char* input, char* arg1, char* arg2, int size);
 #endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include "syscall.h"
+
+// Use the fast path when the kernel found sysenter support
+u32 syscall(u32 num, u32 a1, u32 a2, u32 a3) {
+    if (syscall_fast) return syscall_sysenter(num, a1, a2, a3);
+    return syscall_int80(num, a1, a2, a3);
+}
+
+// A user program whose entry function returns ends up here
+void user_exit() { sys_exit(); }
+
+void sys_exit() { syscall(SYS_EXIT, 0, 0, 0); }
+int sys_print(char* text) { return syscall(SYS_PRINT, (u32)text, 0, 0); }
+int sys_getpid() { return syscall(SYS_GETPID, 0, 0, 0); }
+void sys_yield() { syscall(SYS_YIELD, 0, 0, 0); }
+void* sys_malloc(u32 size) { return (void*)syscall(SYS_MALLOC, size, 0, 0); }
+int sys_spawn(char* name) { return syscall(SYS_SPAWN, (u32)name, 0, 0); }
+int sys_kill(int pid) { return syscall(SYS_KILL, pid, 0, 0); }
+int sys_wait(int pid) { return syscall(SYS_WAIT, pid, 0, 0); }
+int sys_create(char* name) { return syscall(SYS_CREATE, (u32)name, 0, 0); }
+int sys_mkdir(char* name) { return syscall(SYS_MKDIR, (u32)name, 0, 0); }
+int sys_write(char* name, char* text) { return syscall(SYS_WRITE, (u32)name, (u32)text, 0); }
+int sys_read(char* name, char* buf, u32 size) {
+    return syscall(SYS_READ, (u32)name, (u32)buf, size);
+}
+int sys_delete(char* name) { return syscall(SYS_DELETE, (u32)name, 0, 0); }
+int sys_list() { return syscall(SYS_LIST, 0, 0, 0); }
+int sys_chdir(char* path) { return syscall(SYS_CHDIR, (u32)path, 0, 0); }
+void* sys_mmap(char* name, u32 flags) { return (void*)syscall(SYS_MMAP, (u32)name, flags, 0); }
+int sys_munmap(void* addr) { return syscall(SYS_MUNMAP, (u32)addr, 0, 0); }
+int sys_msync(void* addr) { return syscall(SYS_MSYNC, (u32)addr, 0, 0); }
@@ -0,0 +1,33 @@
+#ifndef LIBC_SYSCALL_H
+#define LIBC_SYSCALL_H
+
+#include "../kernel/types.h"
+#include "../kernel/syscall.h"
+
+// User-side system call wrappers, for code running in ring 3
+
+u32 syscall_sysenter(u32 num, u32 a1, u32 a2, u32 a3); // libc/syscall_stubs.asm
+u32 syscall_int80(u32 num, u32 a1, u32 a2, u32 a3);
+u32 syscall(u32 num, u32 a1, u32 a2, u32 a3);
+
+void user_exit();
+void sys_exit();
+int sys_print(char* text);
+int sys_getpid();
+void sys_yield();
+void* sys_malloc(u32 size);
+int sys_spawn(char* name);
+int sys_kill(int pid);
+int sys_wait(int pid);
+int sys_create(char* name);
+int sys_mkdir(char* name);
+int sys_write(char* name, char* text);
+int sys_read(char* name, char* buf, u32 size);
+int sys_delete(char* name);
+int sys_list();
+int sys_chdir(char* path);
+void* sys_mmap(char* name, u32 flags);
+int sys_munmap(void* addr);
+int sys_msync(void* addr);
+
+#endif
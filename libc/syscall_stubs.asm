@@ -0,0 +1,42 @@
+; User side of the system call interface: load the registers and enter
+; the kernel (cpu/syscall.asm). Linked into the kernel for built-in ring-3
+; threads and into every user program.
+[global syscall_sysenter]
+[global syscall_int80]
+
+; u32 syscall_sysenter(u32 num, u32 a1, u32 a2, u32 a3)
+; u32 syscall_int80(u32 num, u32 a1, u32 a2, u32 a3)
+syscall_sysenter:
+    push ebx
+    push esi
+    push edi
+    push ebp
+    mov eax, [esp+20]
+    mov ebx, [esp+24]
+    mov esi, [esp+28]
+    mov edi, [esp+32]
+    mov ecx, esp
+    mov edx, .return
+    sysenter
+.return:
+    pop ebp
+    pop edi
+    pop esi
+    pop ebx
+    ret
+
+syscall_int80:
+    push ebx
+    push esi
+    push edi
+    push ebp
+    mov eax, [esp+20]
+    mov ebx, [esp+24]
+    mov esi, [esp+28]
+    mov edi, [esp+32]
+    int 0x80
+    pop ebp
+    pop edi
+    pop esi
+    pop ebx
+    ret
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Compare "BENCH <name> <cycles>" lines from a benchmark run against a
+# baseline. Fails if any benchmark got slower than THRESHOLD percent.
+# "RATE <name> <per second>" lines (higher is better) are only shown.
+#
+# A missing baseline fails too, unless BENCH_NO_BASELINE=1.
+#
+# Usage: bench_compare.sh <results> <baseline> [threshold-percent]
+
+RESULTS=$1
+BASELINE=$2
+THRESHOLD=${3:-20}
+
+if ! grep -q '^BENCH_DONE' "$RESULTS" 2>/dev/null; then
+    echo "bench: no complete run in $RESULTS (kernel crashed or hung?)"
+    exit 1
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    grep -E '^(BENCH|RATE) ' "$RESULTS"
+    [ "$BENCH_NO_BASELINE" = 1 ] && exit 0
+    echo "bench: no baseline at $BASELINE, run 'make bench-baseline' on this machine first"
+    echo "bench: (or BENCH_NO_BASELINE=1 to only show the results)"
+    exit 1
+fi
+
+tr -d '\r' < "$RESULTS" | awk -v threshold="$THRESHOLD" '
+    FNR == NR { if ($1 == "BENCH") base[$2] = $3; next }
+    $1 == "RATE" { printf "%-16s %10d  per second\n", $2, $3; next }
+    $1 == "BENCH" {
+        name = $2; now = $3
+        if (!(name in base)) { printf "%-16s %10d  (new)\n", name, now; next }
+        change = base[name] > 0 ? (now - base[name]) * 100 / base[name] : 0
+        status = "ok"
+        if (change > threshold) { status = "REGRESSION"; failed = 1 }
+        printf "%-16s %10d  baseline %10d  %+6.1f%%  %s\n", name, now, base[name], change, status
+    }
+    END { exit failed }
+' "$BASELINE" -
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Boot the benchmark kernel padded to 64 KiB, 512 KiB and 4 MiB and print
+# the "BOOT" lines it reports on serial (image size and stage-2 load cycles).
+#
+# Usage: boot_bench.sh <kernel-addr> <kernel objects...>   (make boot-bench)
+
+KERNEL_ADDR=$1
+shift
+
+ld -m elf_i386 -o kernel-pad.bin -Ttext "$KERNEL_ADDR" "$@" --oformat binary || exit 1
+BASE_SIZE=$(stat -c %s kernel-pad.bin)
+
+for kb in 64 512 4096; do
+    pad=$((kb * 1024 - BASE_SIZE))
+    [ $pad -lt 0 ] && pad=0
+    # The padding is linked in as .data, so the kernel header covers it
+    head -c $pad /dev/zero > boot/pad.bin
+    ld -m elf_i386 -r -b binary boot/pad.bin -o boot/pad.o || exit 1
+    ld -m elf_i386 -o kernel-pad.bin -Ttext "$KERNEL_ADDR" "$@" boot/pad.o --oformat binary || exit 1
+    truncate -s %512 kernel-pad.bin
+    cat boot/boot.bin boot/stage2.bin kernel-pad.bin > os-image-pad
+
+    timeout 120 qemu-system-i386 -drive format=raw,file=os-image-pad -display none \
+        -serial file:boot_output.txt -device isa-debug-exit,iobase=0xf4,iosize=0x04
+
+    printf "%5d KiB image: " $kb
+    grep '^BOOT ' boot_output.txt | tr -d '\r' | tr '\n' ' '
+    echo
+done
+rm -f boot/pad.bin boot/pad.o kernel-pad.bin
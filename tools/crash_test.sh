@@ -0,0 +1,33 @@
+#!/bin/sh
+# Crash injection for the journaled file system. Boots the stress kernel
+# (make crash-test builds it with FS_STRESS: it changes files in a loop),
+# kills QEMU at a random moment and checks a copy of the disk image with
+# the host fsck. The same disk is used for every run, so each boot also
+# replays whatever the previous crash left in the journal.
+#
+# Usage: crash_test.sh [runs]   (make crash-test)
+
+RUNS=${1:-20}
+IMAGE=fs-crash.img
+
+rm -f $IMAGE
+truncate -s 1M $IMAGE
+
+run=1
+while [ $run -le $RUNS ]; do
+    # 1.0 to 5.0 seconds: boot takes well under one
+    delay=$(awk -v seed="$run$$" 'BEGIN { srand(seed); printf "%.2f", 1 + rand() * 4 }')
+    timeout -s KILL "$delay" qemu-system-i386 -drive format=raw,file=os-image-stress,index=0 \
+        -drive format=raw,file=$IMAGE,index=1 -display none -serial null
+
+    # fsck replays the journal, so check a copy and leave the original for
+    # the kernel to recover on the next boot
+    cp $IMAGE fs-check.img
+    if ! ./tools/host/fsck fs-check.img; then
+        echo "crash-test: run $run (killed after ${delay}s): image inconsistent"
+        exit 1
+    fi
+    run=$((run + 1))
+done
+rm -f fs-check.img
+echo "crash-test: $RUNS crashes, file system consistent after each"
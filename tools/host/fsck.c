@@ -0,0 +1,45 @@
+// Check an EduOS disk image ("make fsck", tools/crash_test.sh): replay its
+// journal as the kernel would on boot, then check the file table.
+//
+// Usage: fsck [-y] <image>   -y repairs the table
+// Exit status: 0 clean, 1 problems repaired, 4 problems left, 8 no file system
+#include <stdio.h>
+#include "../../libc/string.h"
+#include "../../kernel/fs.h"
+#include "../../kernel/journal.h"
+#include "host_disk.h"
+
+int main(int argc, char** argv) {
+    int repair = argc == 3 && strcmp(argv[1], "-y") == 0;
+    if (argc != 2 + repair) {
+        fprintf(stderr, "usage: %s [-y] <image>\n", argv[0]);
+        return 8;
+    }
+    char* path = argv[1 + repair];
+
+    blockdev_t dev;
+    if (!host_disk_open(path, &dev)) {
+        perror(path);
+        return 8;
+    }
+    fs_quiet = 1;
+    init_fs();
+    int replayed = journal_mount(&dev);
+    if (replayed < 0) {
+        fputs(host_console, stdout);
+        printf("%s: no EduOS file system\n", path);
+        return 8;
+    }
+
+    int problems = fs_check(repair);
+    journal_unmount();
+    host_disk_close();
+
+    int entries = 0;
+    for (int i = 0; i < MAX_FILES; i++) entries += file_system[i].used;
+    fputs(host_console, stdout);
+    printf("%s: %d transactions replayed, %d entries, %d problems%s\n",
+           path, replayed, entries, problems, problems && repair ? " (repaired)" : "");
+    if (!problems) return 0;
+    return repair ? 1 : 4;
+}
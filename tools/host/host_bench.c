@@ -0,0 +1,285 @@
+// Host micro-benchmarks for the plain-C kernel subsystems ("make host-bench").
+// Each benchmark doubles its iteration count until it runs for at least
+// BENCH_MIN_NS, then reports nanoseconds per operation.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../libc/string.h"
+#include "../../libc/lz.h"
+#include "../../kernel/fs.h"
+#include "../../kernel/process.h"
+#include "../../kernel/timer.h"
+#include "../../kernel/journal.h"
+#include "host_disk.h"
+
+#define BENCH_MIN_NS 200000000LL
+
+typedef void (*bench_fn)(long iters);
+
+volatile int sink;
+
+long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Returns nanoseconds per iteration
+double run_bench(char* name, bench_fn fn) {
+    long iters = 1;
+    long long elapsed;
+    for (;;) {
+        long long start = now_ns();
+        fn(iters);
+        elapsed = now_ns() - start;
+        if (elapsed >= BENCH_MIN_NS || iters >= (1L << 30)) break;
+        iters *= 2;
+    }
+    printf("%-20s %12.1f ns/op %12ld iters\n", name, (double)elapsed / iters, iters);
+    return (double)elapsed / iters;
+}
+
+char path_a[] = "/home/projects/eduos/notes.txt";
+char path_b[] = "/home/projects/eduos/notes.txT";
+
+void bm_strlen(long n)     { for (long i = 0; i < n; i++) sink += strlen(path_a); }
+void bm_strcmp(long n)     { for (long i = 0; i < n; i++) sink += strcmp(path_a, path_b); }
+void bm_strcasecmp(long n) { for (long i = 0; i < n; i++) sink += strcasecmp(path_a, path_b); }
+
+// Fill the table so lookups have to walk every slot
+void fs_fill() {
+    char name[MAX_FILENAME];
+    char num[12];
+    strcpy(cwd, "/");
+    init_fs();
+    for (int i = 0; i < MAX_FILES - 2; i++) {
+        strcpy(name, "/file");
+        int_to_ascii(i, num);
+        strcat(name, num);
+        fs_create(name);
+    }
+}
+
+void bm_fs_lookup(long n) {
+    for (long i = 0; i < n; i++) fs_read("/missing");
+    host_console_clear();
+}
+
+void bm_fs_write(long n) {
+    for (long i = 0; i < n; i++) fs_write("/file7", "benchmark payload");
+    host_console_clear();
+}
+
+void bm_fs_create_delete(long n) {
+    for (long i = 0; i < n; i++) {
+        fs_create("/tmp.txt");
+        fs_delete("/tmp.txt");
+    }
+    host_console_clear();
+}
+
+void bm_fs_list(long n) {
+    for (long i = 0; i < n; i++) fs_list();
+    host_console_clear();
+}
+
+int bench_pid;
+
+void bm_proc_lookup(long n) {
+    for (long i = 0; i < n; i++) sink += find_process(bench_pid + (int)(i % 4096)) != 0;
+}
+
+void bm_proc_create_reap(long n) {
+    for (long i = 0; i < n; i++) {
+        int pid = create_process("Bench", 0);
+        kill_process(pid);
+        wait_process(pid);
+    }
+}
+
+// Timer wheel with BENCH_LIVE_TIMERS outstanding timers
+#define BENCH_LIVE_TIMERS 10000
+timer_wheel_t bench_wheel;
+ktimer_t live_timers[BENCH_LIVE_TIMERS];
+ktimer_t probe;
+u32 seed = 1;
+
+void bm_fire(void* arg) { (void)arg; sink++; }
+
+u32 next_delay() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % 10000 + 1;
+}
+
+void bm_timer_add_cancel(long n) {
+    for (long i = 0; i < n; i++) {
+        timer_add(&bench_wheel, &probe, next_delay());
+        timer_cancel(&probe);
+    }
+}
+
+// Each expired timer re-arms itself, so the wheel never drains
+void bm_rearm(void* arg) {
+    timer_add(&bench_wheel, (ktimer_t*)arg, next_delay());
+}
+
+void bm_timer_tick(long n) {
+    for (long i = 0; i < n; i++) timer_tick(&bench_wheel);
+}
+
+// Journaled metadata operations on an image file (flush = fdatasync)
+void bm_journal_ops(long n) {
+    for (long i = 0; i < n; i++) {
+        if (i & 1) fs_delete("/journal.txt");
+        else fs_create("/journal.txt");
+    }
+    if (n & 1) fs_delete("/journal.txt");
+    journal_commit();
+}
+
+void bench_journal() {
+    char path[] = "/tmp/eduos-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || ftruncate(fd, FS_DISK_SECTORS * SECTOR_SIZE) < 0) return;
+    close(fd);
+    blockdev_t dev;
+    if (host_disk_open(path, &dev) && journal_format(&dev)) {
+        fs_quiet = 1;
+        journal_group = 1;
+        double sync_ns = run_bench("journal_op_sync", bm_journal_ops);
+        journal_group = JOURNAL_GROUP;
+        double group_ns = run_bench("journal_op_group", bm_journal_ops);
+        printf("%-20s %12.0f ops/s\n", "journal_sync", 1e9 / sync_ns);
+        printf("%-20s %12.0f ops/s\n", "journal_group", 1e9 / group_ns);
+        journal_unmount();
+        fs_quiet = 0;
+    }
+    host_disk_close();
+    unlink(path);
+}
+
+// --- Compressed file storage on real text: the README and kernel sources,
+// cut into MAX_FILESIZE files ---
+
+#define CORPUS_MAX (512 * 1024)
+#define CORPUS_FILES 16 // Files in the table: four times the decoded cache
+
+char* corpus_paths[] = { "README.md", "kernel/fs.c", "kernel/journal.c", "kernel/vm.c",
+                         "kernel/sched.c", "kernel/kernel.c", "drivers/keyboard.c", 0 };
+char corpus[CORPUS_MAX];
+int corpus_chunks;
+char packed[CORPUS_MAX / MAX_FILESIZE][MAX_FILESIZE];
+int packed_len[CORPUS_MAX / MAX_FILESIZE];
+char read_buf[MAX_FILESIZE];
+File* corpus_file[CORPUS_FILES];
+
+char* chunk(long i) { return corpus + (i % corpus_chunks) * MAX_FILESIZE; }
+
+void bm_lz_compress(long n) {
+    for (long i = 0; i < n; i++) sink += lz_compress(chunk(i), MAX_FILESIZE, packed[0], MAX_FILESIZE);
+}
+
+void bm_lz_decompress(long n) {
+    for (long i = 0; i < n; i++) {
+        int c = i % corpus_chunks;
+        sink += lz_decompress(packed[c], packed_len[c], read_buf, MAX_FILESIZE);
+    }
+}
+
+void bm_fs_write_file(long n) {
+    for (long i = 0; i < n; i++) {
+        File* f = corpus_file[i % CORPUS_FILES];
+        fs_write_data(f->name, chunk(i), MAX_FILESIZE);
+    }
+}
+
+void bm_fs_read_file(long n) {
+    for (long i = 0; i < n; i++) {
+        File* f = corpus_file[i % CORPUS_FILES];
+        memory_copy(fs_data(f), read_buf, f->size);
+    }
+}
+
+void bm_fs_read_cached(long n) {
+    for (long i = 0; i < n; i++) memory_copy(fs_data(corpus_file[0]), read_buf, corpus_file[0]->size);
+}
+
+void print_rate(char* name, double ns) {
+    printf("%-20s %12.1f MB/s\n", name, MAX_FILESIZE * 1e3 / ns);
+}
+
+void bench_compress() {
+    int len = 0;
+    for (int p = 0; corpus_paths[p]; p++) {
+        FILE* file = fopen(corpus_paths[p], "rb");
+        if (!file) continue;
+        len += fread(corpus + len, 1, CORPUS_MAX - len, file);
+        fclose(file);
+    }
+    corpus_chunks = len / MAX_FILESIZE;
+    if (corpus_chunks == 0) return; // Not run from the source tree
+
+    long raw = 0, stored = 0;
+    for (int c = 0; c < corpus_chunks; c++) {
+        packed_len[c] = lz_compress(chunk(c), MAX_FILESIZE, packed[c], MAX_FILESIZE);
+        raw += MAX_FILESIZE;
+        stored += packed_len[c] ? packed_len[c] : MAX_FILESIZE;
+    }
+    printf("%-20s %12.1f %% of %ld bytes\n", "lz_ratio", 100.0 * stored / raw, raw);
+    print_rate("lz_compress", run_bench("lz_compress", bm_lz_compress));
+    print_rate("lz_decompress", run_bench("lz_decompress", bm_lz_decompress));
+
+    char name[MAX_FILENAME];
+    char num[12];
+    strcpy(cwd, "/");
+    init_fs();
+    fs_quiet = 1;
+    for (int i = 0; i < CORPUS_FILES; i++) {
+        strcpy(name, "/corpus");
+        int_to_ascii(i, num);
+        strcat(name, num);
+        fs_create(name);
+        corpus_file[i] = fs_find(name);
+    }
+    for (int lz = 0; lz <= 1; lz++) {
+        fs_set_compress(lz);
+        print_rate(lz ? "fs_write_lz" : "fs_write_raw", run_bench(lz ? "fs_write_lz" : "fs_write_raw", bm_fs_write_file));
+        print_rate(lz ? "fs_read_lz" : "fs_read_raw", run_bench(lz ? "fs_read_lz" : "fs_read_raw", bm_fs_read_file));
+    }
+    print_rate("fs_read_lz_cached", run_bench("fs_read_lz_cached", bm_fs_read_cached));
+    fs_set_compress(0);
+    init_fs();
+    fs_quiet = 0;
+}
+
+int main() {
+    run_bench("str_strlen", bm_strlen);
+    run_bench("str_strcmp", bm_strcmp);
+    run_bench("str_strcasecmp", bm_strcasecmp);
+
+    fs_fill();
+    run_bench("fs_lookup_miss", bm_fs_lookup);
+    run_bench("fs_write", bm_fs_write);
+    run_bench("fs_create_delete", bm_fs_create_delete);
+    run_bench("fs_list", bm_fs_list);
+    bench_journal();
+    bench_compress();
+
+    // 4096 live processes
+    init_process_manager();
+    bench_pid = create_process("Bench", 0);
+    for (int i = 1; i < 4096; i++) create_process("Bench", 0);
+    run_bench("proc_lookup", bm_proc_lookup);
+    run_bench("proc_create_reap", bm_proc_create_reap);
+
+    timer_wheel_init(&bench_wheel);
+    timer_init(&probe, bm_fire, 0);
+    for (int i = 0; i < BENCH_LIVE_TIMERS; i++) {
+        timer_init(&live_timers[i], bm_rearm, &live_timers[i]);
+        timer_add(&bench_wheel, &live_timers[i], next_delay());
+    }
+    run_bench("timer_add_cancel", bm_timer_add_cancel);
+    run_bench("timer_tick", bm_timer_tick);
+    return 0;
+}
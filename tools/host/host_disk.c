@@ -0,0 +1,37 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "host_disk.h"
+
+int host_disk_fd = -1;
+
+int host_disk_read(u32 lba, u32 count, void* buf) {
+    ssize_t len = (ssize_t)count * SECTOR_SIZE;
+    return pread(host_disk_fd, buf, len, (off_t)lba * SECTOR_SIZE) == len;
+}
+
+int host_disk_write(u32 lba, u32 count, void* buf) {
+    ssize_t len = (ssize_t)count * SECTOR_SIZE;
+    return pwrite(host_disk_fd, buf, len, (off_t)lba * SECTOR_SIZE) == len;
+}
+
+int host_disk_flush() {
+    return fdatasync(host_disk_fd) == 0;
+}
+
+// Returns 0 if the file cannot be opened
+int host_disk_open(char* path, blockdev_t* dev) {
+    struct stat st;
+    host_disk_fd = open(path, O_RDWR);
+    if (host_disk_fd < 0 || fstat(host_disk_fd, &st) < 0) return 0;
+    dev->sectors = st.st_size / SECTOR_SIZE;
+    dev->read = host_disk_read;
+    dev->write = host_disk_write;
+    dev->flush = host_disk_flush;
+    return 1;
+}
+
+void host_disk_close() {
+    close(host_disk_fd);
+    host_disk_fd = -1;
+}
@@ -0,0 +1,10 @@
+#ifndef HOST_DISK_H
+#define HOST_DISK_H
+
+#include "../../kernel/journal.h"
+
+// A disk image file as a blockdev_t; flush is fdatasync()
+int host_disk_open(char* path, blockdev_t* dev);
+void host_disk_close();
+
+#endif
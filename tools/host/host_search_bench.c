@@ -0,0 +1,94 @@
+// grep at scale ("make host-bench"): a full scan against the trigram
+// index over 1,000 and 10,000 files. The kernel's file table only has a
+// few slots, so this binary is built with a larger MAX_FILES.
+#include <stdio.h>
+#include <time.h>
+#include "../../libc/string.h"
+#include "../../kernel/fs.h"
+#include "../../kernel/search.h"
+
+#define BENCH_MIN_NS 200000000LL
+#define NEEDLE "quasar"
+
+typedef void (*bench_fn)(long iters);
+
+volatile int sink;
+
+long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void run_bench(char* name, bench_fn fn) {
+    long iters = 1;
+    long long elapsed;
+    for (;;) {
+        long long start = now_ns();
+        fn(iters);
+        elapsed = now_ns() - start;
+        if (elapsed >= BENCH_MIN_NS || iters >= (1L << 30)) break;
+        iters *= 2;
+    }
+    printf("%-20s %12.1f ns/op %12ld iters\n", name, (double)elapsed / iters, iters);
+}
+
+char* words[] = { "kernel ", "page ", "thread ", "pipe ", "timer ", "file ", "\n" };
+
+// Files 0..count-1, each a full slot of pseudo-random words. Only the
+// last one contains NEEDLE.
+void fill_files(int count) {
+    char name[MAX_FILENAME];
+    char num[12];
+    char text[MAX_FILESIZE];
+    unsigned seed = 1;
+
+    strcpy(cwd, "/");
+    fs_quiet = 1;
+    init_fs();
+    for (int i = 0; i < count; i++) {
+        int pos = 0;
+        while (pos < MAX_FILESIZE) {
+            seed = seed * 1103515245 + 12345;
+            char* w = words[(seed >> 16) % 7];
+            while (*w && pos < MAX_FILESIZE) text[pos++] = *w++;
+        }
+        if (i == count - 1) memory_copy(NEEDLE, text + MAX_FILESIZE / 2, strlen(NEEDLE));
+
+        strcpy(name, "/doc");
+        int_to_ascii(i, num);
+        strcat(name, num);
+        fs_create(name);
+        fs_write_data(name, text, MAX_FILESIZE);
+    }
+}
+
+void bm_grep(long n) {
+    for (long i = 0; i < n; i++) sink += search_grep(NEEDLE, "/", 1);
+}
+
+void bench_files(int count, char* suffix) {
+    char name[32];
+    fill_files(count);
+
+    index_enable(0);
+    sse2_enabled = 0;
+    strcpy(name, "grep_scalar_"); strcat(name, suffix);
+    run_bench(name, bm_grep);
+    sse2_enabled = 1;
+    strcpy(name, "grep_scan_"); strcat(name, suffix);
+    run_bench(name, bm_grep);
+
+    long long start = now_ns();
+    index_enable(1);
+    printf("%-20s %12.1f ns/file\n", "index_build", (double)(now_ns() - start) / count);
+    strcpy(name, "grep_index_"); strcat(name, suffix);
+    run_bench(name, bm_grep);
+    index_enable(0);
+}
+
+int main() {
+    bench_files(1000, "1k");
+    bench_files(10000, "10k");
+    return 0;
+}
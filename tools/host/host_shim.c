@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../drivers/screen.h"
+#include "../../kernel/mem.h"
+#include "../../kernel/vm.h"
+
+char host_console[HOST_CONSOLE_SIZE];
+int host_console_len = 0;
+
+void host_console_clear() {
+    host_console_len = 0;
+    host_console[0] = '\0';
+}
+
+int host_console_contains(char* text) {
+    for (int i = 0; host_console[i] != '\0'; i++) {
+        int j = 0;
+        while (text[j] != '\0' && host_console[i + j] == text[j]) j++;
+        if (text[j] == '\0') return 1;
+    }
+    return 0;
+}
+
+// Fake screen driver: append to the capture buffer (wraps when full).
+// Set EDUOS_ECHO=1 to also see the output on stdout.
+void kprint(char *message) {
+    static int echo = -1;
+    if (echo < 0) echo = getenv("EDUOS_ECHO") != NULL;
+    if (echo) fputs(message, stdout);
+
+    for (int i = 0; message[i] != '\0'; i++) {
+        if (host_console_len >= HOST_CONSOLE_SIZE - 1) host_console_len = 0;
+        host_console[host_console_len++] = message[i];
+    }
+    host_console[host_console_len] = '\0';
+}
+
+void kprint_at(char *message, int col, int row) {
+    (void)col; (void)row;
+    kprint(message);
+}
+
+void clear_screen() {
+    host_console_clear();
+}
+
+// Fake page allocator: a free list over a pool from the host heap
+#define HOST_POOL_SIZE (64 * 1024 * 1024)
+
+u32 pages_total = HOST_POOL_SIZE / PAGE_SIZE;
+u32 pages_used = 0;
+char* pool = 0;
+u32 pool_next = 0;
+void* host_free_pages = 0;
+
+void* page_alloc_contig(u32 count) {
+    if (!pool) pool = aligned_alloc(PAGE_SIZE, HOST_POOL_SIZE);
+    if (count == 1 && host_free_pages) {
+        void* page = host_free_pages;
+        host_free_pages = *(void**)page;
+        pages_used++;
+        return page;
+    }
+    if (pool_next + count * PAGE_SIZE > HOST_POOL_SIZE) return 0;
+    void* pages = pool + pool_next;
+    pool_next += count * PAGE_SIZE;
+    pages_used += count;
+    return pages;
+}
+
+void* page_alloc() {
+    return page_alloc_contig(1);
+}
+
+void page_free(void* page) {
+    *(void**)page = host_free_pages;
+    host_free_pages = page;
+    pages_used--;
+}
+
+// No paging on the host: processes never have a user address space
+void vm_destroy(Process* p) {
+    (void)p;
+}
+
+// SSE needs no switching on in a host process
+void simd_begin() {}
+void simd_end() {}
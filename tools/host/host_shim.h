@@ -0,0 +1,21 @@
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+// Force-included (-include) into every file of the host build.
+// The kernel's libc clashes with glibc names, so rename it here.
+#define strlen     eduos_strlen
+#define strcmp     eduos_strcmp
+#define strcpy     eduos_strcpy
+#define strcat     eduos_strcat
+#define strcasecmp eduos_strcasecmp
+#define strlcpy    eduos_strlcpy
+
+#define HOST_CONSOLE_SIZE 65536
+
+// Everything the kernel kprint()s ends up here instead of VGA memory
+extern char host_console[HOST_CONSOLE_SIZE];
+
+void host_console_clear();
+int host_console_contains(char* text);
+
+#endif
@@ -0,0 +1,23 @@
+#include "../libc/syscall.h"
+
+// Program entry: pick the system call path, run main(), exit
+
+#define CPUID_SEP (1 << 11)
+
+int syscall_fast = 0;
+
+// libc's mem_find brackets SSE use with these; only the kernel turns SSE
+// on (sse2_enabled), so here they have nothing to do
+void simd_begin() {}
+void simd_end() {}
+
+void main();
+
+__attribute__((section(".text.start")))
+void _start() {
+    u32 eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    syscall_fast = (edx & CPUID_SEP) != 0;
+    main();
+    sys_exit();
+}
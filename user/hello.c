@@ -0,0 +1,10 @@
+#include "../libc/syscall.h"
+#include "../libc/string.h"
+
+void main() {
+    char pid[12];
+    int_to_ascii(sys_getpid(), pid);
+    sys_print("Hello from /bin/hello, PID ");
+    sys_print(pid);
+    sys_print("\n");
+}
@@ -0,0 +1,43 @@
+#include "../libc/syscall.h"
+
+// Checks file mappings and copy-on-write from ring 3. Prints
+// "maptest: ok", or "maptest: !" and the letter of the first check that
+// failed. Programs must fit in a 1 KiB file, so the checks are terse.
+
+#define NAME "/map"
+
+int counter = 7; // Its page is shared with the program file until written
+char result[] = "maptest: ok\n";
+
+char run() {
+    char buf[8];
+    if (counter++ != 7) return 'd'; // An earlier run's write reached the file
+
+    sys_create(NAME);
+    sys_write(NAME, "map");
+    char* ro = (char*)sys_mmap(NAME, 0);
+    char* priv = (char*)sys_mmap(NAME, MMAP_WRITE);
+    char* shared = (char*)sys_mmap(NAME, MMAP_WRITE | MMAP_SHARED);
+    priv[0] = 'n';
+    if (ro[0] != 'm') return 'p'; // Private writes stay private
+
+    shared[0] = 'z';
+    if (ro[0] != 'z') return 's';
+    sys_msync(shared);
+    sys_read(NAME, buf, sizeof(buf));
+    if (buf[0] != 'z') return 'f';
+
+    // Once the file is gone msync refuses, but munmap still works
+    sys_delete(NAME);
+    if (!sys_msync(shared) || sys_munmap(shared)) return 'u';
+    return 0;
+}
+
+void main() {
+    char failed = run();
+    if (failed) {
+        result[9] = '!';
+        result[10] = failed;
+    }
+    sys_print(result);
+}
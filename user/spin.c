@@ -0,0 +1,12 @@
+#include "../libc/syscall.h"
+
+// Benchmark program: touch a data page and a bss page, let the other
+// instances start, then exit
+
+int counter = 1;
+char scratch[4096];
+
+void main() {
+    scratch[0] = (char)counter++;
+    sys_yield();
+}